@@ -26,3 +26,20 @@
 #pragma once
 
 #include "mpiex/operations.h"
+#include "mpiex/autotune.h"
+#include "mpiex/fusion.h"
+#include "mpiex/compressed.h"
+#include "mpiex/sparse.h"
+#include "mpiex/topology.h"
+#include "mpiex/halo.h"
+#include "mpiex/window.h"
+#include "mpiex/node_shared.h"
+#include "mpiex/counter.h"
+#include "mpiex/dist_vector.h"
+#include "mpiex/dist_map.h"
+#include "mpiex/rma_cache.h"
+#include "mpiex/rpc.h"
+
+#if defined(__linux__)
+#include "mpiex/eventfd_notifier.h"
+#endif
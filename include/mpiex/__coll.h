@@ -0,0 +1,68 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "__config.h"
+#include "communicator.h"
+
+#include <vector>
+
+namespace mpiex
+{
+
+// Library-side collectives built on point-to-point messages run on a
+// private duplicate of the user's communicator, cached on it as an MPI
+// attribute, so that they never match the user's messages.  Each operation
+// draws a fresh tag, so that concurrent operations never match each other
+// either; since collectives are started in the same order on all ranks,
+// the tags agree.
+
+struct __coll_channel
+{
+	MPI_Comm comm;
+	int tag;
+	int rank;
+	int size;
+};
+
+// collective on the first call for a communicator
+__coll_channel __coll_begin(communicator comm);
+
+// The ranks of a communicator grouped by shared-memory node, for the
+// node-aware collectives.  The rank 0 of each node is its leader.
+struct __node_layout
+{
+	MPI_Comm node;
+	MPI_Comm leaders;	// MPI_COMM_NULL on the other ranks
+	std::vector<int> node_of;	// rank in leaders of the leader of a rank
+	std::vector<int> node_rank_of;	// rank in node of a rank
+};
+
+// collective on the first call for a communicator; the result lives as
+// long as the communicator
+__node_layout const& __node_begin(communicator comm);
+
+}
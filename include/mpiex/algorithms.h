@@ -0,0 +1,777 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "future.h"
+#include "traits.h"
+#include "communicator.h"
+#include "__coll.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace mpiex
+{
+
+// Thresholds of the automatic algorithm selection.  They shall be the same
+// on all the ranks of a communicator.
+struct collective_tuning
+{
+	// largest block, in bytes, sent to each peer by alltoall_bruck
+	size_t alltoall_bruck_max = 256;
+
+	// largest message, in bytes, sent by allreduce_ring
+	size_t allreduce_ring_chunk = 1 << 20;
+
+	// file to persist the choices of the tuned collectives across runs,
+	// read and written by rank 0 of a communicator; none if empty
+	std::string autotune_file;
+
+	// timed runs of each candidate, after a warm-up run
+	int autotune_reps = 5;
+
+	// ratio of the bytes of the index/value pairs to those of the dense
+	// array, above which sparse_allreduce goes dense
+	double sparse_dense_ratio = 1.0;
+
+	// seconds of work per chunk aimed at by loop_schedule::adaptive
+	double loop_chunk_time = 1e-3;
+};
+
+inline
+collective_tuning&
+tuning()
+{
+	static collective_tuning t;
+	return t;
+}
+
+template <typename T>
+struct __bruck_alltoall_step
+{
+	__coll_channel ch;
+	T const* p;
+	T* q;
+	size_t sz;
+	int dist;
+	std::vector<T> tmp;
+	std::vector<T> sbuf;
+	std::vector<T> rbuf;
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		auto n = ch.size;
+
+		if (dist == 0)
+		{
+			// the block to send to rank + i goes to index i
+			tmp.resize(n * sz);
+			for (int i = 0; i < n; ++i)
+				std::copy_n(p + (ch.rank + i) % n * sz, sz,
+				    tmp.data() + i * sz);
+			dist = 1;
+		}
+		else
+		{
+			unpack();
+			dist <<= 1;
+		}
+
+		if (dist < n)
+		{
+			// round log2(dist): forward every block whose index has
+			// this bit set by dist ranks
+			sbuf.clear();
+			for (int i = dist; i < n; ++i)
+				if (i & dist)
+					sbuf.insert(sbuf.end(), tmp.data() + i * sz,
+					    tmp.data() + (i + 1) * sz);
+			rbuf.resize(sbuf.size());
+
+			MPI_Request r;
+			MPI_Irecv(rbuf.data(), int(rbuf.size()), mpi_type_of<T>{},
+			    (ch.rank - dist + n) % n, ch.tag, ch.comm, &r);
+			reqs.push_back(r);
+			MPI_Isend(sbuf.data(), int(sbuf.size()), mpi_type_of<T>{},
+			    (ch.rank + dist) % n, ch.tag, ch.comm, &r);
+			reqs.push_back(r);
+			return true;
+		}
+
+		// index i now holds the block from rank - i
+		for (int i = 0; i < n; ++i)
+			std::copy_n(tmp.data() + i * sz, sz,
+			    q + (ch.rank - i + n) % n * sz);
+		return false;
+	}
+
+	void unpack()
+	{
+		auto src = rbuf.data();
+		for (int i = dist; i < ch.size; ++i)
+			if (i & dist)
+			{
+				std::copy_n(src, sz, tmp.data() + i * sz);
+				src += sz;
+			}
+	}
+};
+
+template <typename T>
+inline
+future<void>
+alltoall_bruck(communicator comm, T const* p, T* q, size_t sz)
+{
+	return __make_mpi_staged_assoc_state<void>(
+	    __bruck_alltoall_step<T>{ __coll_begin(comm), p, q, sz, 0 });
+}
+
+template <typename T, typename F>
+struct __ring_allreduce_step
+{
+	__coll_channel ch;
+	T* q;
+	size_t sz;
+	size_t chunk;
+	F f;
+	int step;
+	std::vector<T> tmp;
+
+	// segment i of the P segments is [offset(i), offset(i + 1))
+	size_t offset(int i) const
+	{
+		auto n = size_t(ch.size);
+		auto k = size_t(i);
+		return k * (sz / n) + std::min(k, sz % n);
+	}
+
+	// chunk c of segment i, clipped; may be empty
+	std::pair<size_t, size_t> part(int i, size_t c) const
+	{
+		auto first = offset(i);
+		auto last = offset(i + 1);
+		auto b = std::min(first + c * chunk, last);
+		return { b, std::min(b + chunk, last) - b };
+	}
+
+	size_t chunks() const
+	{
+		auto len = offset(1);
+		return len == 0 ? 0 : (len + chunk - 1) / chunk;
+	}
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		auto n = ch.size;
+		int last = 2 * (n - 1);
+
+		if (step == 0)
+			tmp.resize(offset(1));
+
+		// the segment received in the previous step is the one to send
+		// in this step, so each chunk is forwarded as soon as it is
+		// reduced, overlapping the reduction of the next chunks
+		for (size_t c = 0; c < chunks(); ++c)
+		{
+			if (step > 0 && step < n)
+			{
+				auto pr = part((ch.rank - step + n) % n, c);
+				auto t = tmp.data() + c * chunk;
+				for (size_t i = 0; i < pr.second; ++i)
+					q[pr.first + i] = f(q[pr.first + i], t[i]);
+			}
+
+			if (step < last)
+				post(reqs, c);
+		}
+
+		return step++ < last;
+	}
+
+	void post(std::vector<MPI_Request>& reqs, size_t c)
+	{
+		auto n = ch.size;
+		int s, r;
+		T* rp;
+
+		if (step < n - 1)
+		{
+			// reduce-scatter
+			s = (ch.rank - step + n) % n;
+			r = (ch.rank - step - 1 + n) % n;
+			rp = tmp.data() + c * chunk;
+		}
+		else
+		{
+			// allgather
+			s = (ch.rank + 1 - (step - n + 1) + n) % n;
+			r = (ch.rank - (step - n + 1) + n) % n;
+			rp = q + part(r, c).first;
+		}
+
+		auto ps = part(s, c);
+		auto pr = part(r, c);
+
+		MPI_Request req;
+		MPI_Irecv(rp, int(pr.second), mpi_type_of<T>{}, (ch.rank + n - 1) % n,
+		    ch.tag, ch.comm, &req);
+		reqs.push_back(req);
+		MPI_Isend(q + ps.first, int(ps.second), mpi_type_of<T>{},
+		    (ch.rank + 1) % n, ch.tag, ch.comm, &req);
+		reqs.push_back(req);
+	}
+};
+
+template <typename T, typename F>
+inline
+future<void>
+allreduce_ring(communicator comm, T const* p, T* q, size_t sz, F f,
+    size_t chunk = 0)
+{
+	if (chunk == 0)
+		chunk = std::max(tuning().allreduce_ring_chunk / sizeof(T),
+		    size_t(1));
+	if (p != q)
+		std::copy_n(p, sz, q);
+
+	return __make_mpi_staged_assoc_state<void>(
+	    __ring_allreduce_step<T, F>{ __coll_begin(comm), q, sz, chunk, f,
+	    0 });
+}
+
+enum class tree_shape
+{
+	kary,
+	binomial,
+	recursive_doubling
+};
+
+// links of the node with relative rank vr in a tree rooted at 0; with
+// tree_shape::binomial, a k-nomial tree, which is binomial when k is 2
+inline
+int
+__tree_links(tree_shape shape, int k, int vr, int n, std::vector<int>& children)
+{
+	children.clear();
+
+	if (shape == tree_shape::kary)
+	{
+		for (int j = 1; j <= k && k * vr + j < n; ++j)
+			children.push_back(k * vr + j);
+		return vr == 0 ? -1 : (vr - 1) / k;
+	}
+
+	for (int w = 1; w < n; w *= k)
+	{
+		int digit = vr / w % k;
+		if (digit != 0)
+			return vr - digit * w;
+		for (int j = 1; j < k && vr + j * w < n; ++j)
+			children.push_back(vr + j * w);
+	}
+	return -1;
+}
+
+template <typename T, typename F>
+struct __tree_reduce_step
+{
+	__coll_channel ch;
+	int root;
+	T const* p;
+	T* q;
+	size_t sz;
+	F f;
+	tree_shape shape;
+	int k;
+	int stage;
+	int parent;
+	std::vector<int> children;
+	std::vector<T> acc;
+	std::vector<T> bufs;
+
+	int rank_of(int vr) const
+	{
+		return (vr + root) % ch.size;
+	}
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		MPI_Request r;
+
+		if (stage++ == 0)
+		{
+			int vr = (ch.rank - root + ch.size) % ch.size;
+			parent = __tree_links(shape, k, vr, ch.size, children);
+			acc.assign(p, p + sz);
+			bufs.resize(children.size() * sz);
+
+			// a level proceeds once all its children have arrived,
+			// whatever the progress of the other subtrees
+			for (size_t i = 0; i < children.size(); ++i)
+			{
+				MPI_Irecv(bufs.data() + i * sz, int(sz),
+				    mpi_type_of<T>{}, rank_of(children[i]), ch.tag,
+				    ch.comm, &r);
+				reqs.push_back(r);
+			}
+			return true;
+		}
+
+		for (size_t i = 0; i < children.size(); ++i)
+		{
+			auto b = bufs.data() + i * sz;
+			for (size_t j = 0; j < sz; ++j)
+				acc[j] = f(acc[j], b[j]);
+		}
+
+		if (parent == -1)
+			std::copy(acc.begin(), acc.end(), q);
+		else
+		{
+			MPI_Isend(acc.data(), int(sz), mpi_type_of<T>{},
+			    rank_of(parent), ch.tag, ch.comm, &r);
+			reqs.push_back(r);
+		}
+		return false;
+	}
+};
+
+template <typename T>
+struct __tree_bcast_step
+{
+	__coll_channel ch;
+	int root;
+	T* p;
+	size_t sz;
+	tree_shape shape;
+	int k;
+	int stage;
+	int parent;
+	std::vector<int> children;
+
+	int rank_of(int vr) const
+	{
+		return (vr + root) % ch.size;
+	}
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		MPI_Request r;
+
+		if (stage == 0)
+		{
+			int vr = (ch.rank - root + ch.size) % ch.size;
+			parent = __tree_links(shape, k, vr, ch.size, children);
+		}
+
+		if (stage++ == 0 && parent != -1)
+		{
+			MPI_Irecv(p, int(sz), mpi_type_of<T>{}, rank_of(parent),
+			    ch.tag, ch.comm, &r);
+			reqs.push_back(r);
+			return true;
+		}
+
+		// the largest subtrees first
+		for (auto it = children.rbegin(); it != children.rend(); ++it)
+		{
+			MPI_Isend(p, int(sz), mpi_type_of<T>{}, rank_of(*it), ch.tag,
+			    ch.comm, &r);
+			reqs.push_back(r);
+		}
+		return false;
+	}
+};
+
+// Recursive doubling among the largest power-of-two subset of the nodes;
+// each of the first 2 * rem nodes pairs up, the even one handing its data
+// to the odd one before the exchange, and receiving the result after it.
+template <typename T, typename F>
+struct __rd_allreduce_step
+{
+	__coll_channel ch;
+	T const* p;
+	T* q;
+	size_t sz;
+	F f;
+	int phase;
+	int pof2;
+	int rem;
+	int vr;
+	int dist;
+	std::vector<T> acc;
+	std::vector<T> tmp;
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		auto r = ch.rank;
+
+		switch (phase)
+		{
+		case 0:
+			acc.assign(p, p + sz);
+			tmp.resize(sz);
+			for (pof2 = 1; pof2 * 2 <= ch.size; pof2 *= 2)
+				;
+			rem = ch.size - pof2;
+
+			if (r < 2 * rem && r % 2 == 0)
+			{
+				post(reqs, r + 1);
+				phase = 3;
+				return true;
+			}
+			else if (r < 2 * rem)
+			{
+				post_recv(reqs, r - 1);
+				phase = 1;
+				return true;
+			}
+
+			vr = r - rem;
+			dist = 1;
+			break;
+
+		case 1:
+			combine();
+			vr = r / 2;
+			dist = 1;
+			break;
+
+		case 2:
+			combine();
+			dist <<= 1;
+			break;
+
+		case 3:
+			if (q)
+				std::copy(tmp.begin(), tmp.end(), q);
+			return false;
+		}
+
+		if (dist < pof2)
+		{
+			int peer = vr ^ dist;
+			post(reqs, peer < rem ? peer * 2 + 1 : peer + rem);
+			phase = 2;
+			return true;
+		}
+
+		if (q)
+			std::copy(acc.begin(), acc.end(), q);
+		if (r < 2 * rem)
+		{
+			MPI_Request req;
+			MPI_Isend(acc.data(), int(sz), mpi_type_of<T>{}, r - 1, ch.tag,
+			    ch.comm, &req);
+			reqs.push_back(req);
+		}
+		return false;
+	}
+
+	void post(std::vector<MPI_Request>& reqs, int peer)
+	{
+		post_recv(reqs, peer);
+
+		MPI_Request req;
+		MPI_Isend(acc.data(), int(sz), mpi_type_of<T>{}, peer, ch.tag,
+		    ch.comm, &req);
+		reqs.push_back(req);
+	}
+
+	void post_recv(std::vector<MPI_Request>& reqs, int peer)
+	{
+		MPI_Request req;
+		MPI_Irecv(tmp.data(), int(sz), mpi_type_of<T>{}, peer, ch.tag,
+		    ch.comm, &req);
+		reqs.push_back(req);
+	}
+
+	void combine()
+	{
+		for (size_t i = 0; i < sz; ++i)
+			acc[i] = f(acc[i], tmp[i]);
+	}
+};
+
+template <typename T, typename F>
+struct __tree_allreduce_step
+{
+	__tree_reduce_step<T, F> reduce;
+	__tree_bcast_step<T> bcast;
+	bool reducing;
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		if (reducing && (reducing = reduce(reqs)))
+			return true;
+
+		// the two phases send in opposite directions along the same
+		// links, so they share the tag
+		return bcast(reqs);
+	}
+};
+
+template <typename T, typename F>
+inline
+future<void>
+tree_reduce(communicator comm, int root, T const* p, T* q, size_t sz, F f,
+    tree_shape shape = tree_shape::binomial, int k = 2)
+{
+	auto ch = __coll_begin(comm);
+
+	if (shape == tree_shape::recursive_doubling)
+		return __make_mpi_staged_assoc_state<void>(
+		    __rd_allreduce_step<T, F>{ ch, p,
+		    ch.rank == root ? q : nullptr, sz, f, 0 });
+
+	return __make_mpi_staged_assoc_state<void>(
+	    __tree_reduce_step<T, F>{ ch, root, p, q, sz, f, shape, k, 0 });
+}
+
+template <typename T, typename F>
+inline
+future<void>
+tree_allreduce(communicator comm, T const* p, T* q, size_t sz, F f,
+    tree_shape shape = tree_shape::recursive_doubling, int k = 2)
+{
+	auto ch = __coll_begin(comm);
+
+	if (shape == tree_shape::recursive_doubling)
+		return __make_mpi_staged_assoc_state<void>(
+		    __rd_allreduce_step<T, F>{ ch, p, q, sz, f, 0 });
+
+	return __make_mpi_staged_assoc_state<void>(
+	    __tree_allreduce_step<T, F>{
+	    { ch, 0, p, q, sz, f, shape, k, 0 },
+	    { ch, 0, q, sz, shape, k, 0 }, true });
+}
+
+template <typename T>
+inline
+future<void>
+tree_bcast(communicator comm, int root, T* p, size_t sz,
+    tree_shape shape = tree_shape::binomial, int k = 2)
+{
+	// recursive doubling broadcasts along a binomial tree
+	if (shape == tree_shape::recursive_doubling)
+		shape = tree_shape::binomial;
+
+	return __make_mpi_staged_assoc_state<void>(
+	    __tree_bcast_step<T>{ __coll_begin(comm), root, p, sz, shape, k,
+	    0 });
+}
+
+// Node-aware collectives: the ranks of a node reduce to, or broadcast from,
+// their leader over the node, and only the leaders talk across the nodes.
+// The phases run back to back; a rank skips those not involving it.
+
+// a channel among the leaders, or a dummy on the other ranks
+inline
+__coll_channel
+__leaders_begin(__node_layout const& lo)
+{
+	if (lo.leaders == MPI_COMM_NULL)
+		return { MPI_COMM_NULL, 0, 0, 1 };
+
+	return __coll_begin(communicator(lo.leaders));
+}
+
+template <typename T, typename F>
+struct __hier_reduce_step
+{
+	__tree_reduce_step<T, F> local;
+	__tree_reduce_step<T, F> across;
+	__coll_channel node;
+	bool is_leader;
+	int root_node_rank;	// -1 if the root is on another node
+	T* q;
+	int phase;
+	std::vector<T> part;
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		MPI_Request r;
+
+		if (phase == 0)
+		{
+			part.resize(local.sz);
+			local.q = across.q = part.data();
+			across.p = part.data();
+			phase = 1;
+		}
+
+		if (phase == 1)
+		{
+			if (local(reqs))
+				return true;
+			phase = 2;
+		}
+
+		if (phase == 2)
+		{
+			if (is_leader && across(reqs))
+				return true;
+			phase = 3;
+		}
+
+		// the leader of the node of the root hands the result over
+		if (root_node_rank == 0 && is_leader)
+			std::copy(part.begin(), part.end(), q);
+		else if (root_node_rank > 0 && is_leader)
+		{
+			MPI_Isend(part.data(), int(part.size()), mpi_type_of<T>{},
+			    root_node_rank, node.tag, node.comm, &r);
+			reqs.push_back(r);
+		}
+		else if (root_node_rank > 0 && node.rank == root_node_rank)
+		{
+			MPI_Irecv(q, int(part.size()), mpi_type_of<T>{}, 0, node.tag,
+			    node.comm, &r);
+			reqs.push_back(r);
+		}
+		return false;
+	}
+};
+
+template <typename T, typename F>
+struct __hier_allreduce_step
+{
+	__tree_reduce_step<T, F> local;
+	__rd_allreduce_step<T, F> across;
+	__tree_bcast_step<T> back;
+	bool is_leader;
+	int phase;
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		if (phase == 0)
+		{
+			if (local(reqs))
+				return true;
+			phase = 1;
+		}
+
+		if (phase == 1)
+		{
+			if (is_leader && across(reqs))
+				return true;
+			phase = 2;
+		}
+
+		return back(reqs);
+	}
+};
+
+template <typename T>
+struct __hier_bcast_step
+{
+	__tree_bcast_step<T> local;
+	__tree_bcast_step<T> across;
+	bool is_leader;
+	bool root_node;
+	int phase;
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		// on the node of the root, the leader receives the data before
+		// forwarding it to the other leaders; elsewhere, after
+		if (phase == 0)
+		{
+			if (root_node && local(reqs))
+				return true;
+			phase = 1;
+		}
+
+		if (phase == 1)
+		{
+			if (is_leader && across(reqs))
+				return true;
+			phase = 2;
+		}
+
+		return !root_node && local(reqs);
+	}
+};
+
+template <typename T, typename F>
+inline
+future<void>
+hier_reduce(communicator comm, int root, T const* p, T* q, size_t sz, F f)
+{
+	auto& lo = __node_begin(comm);
+	auto node = __coll_begin(communicator(lo.node));
+	auto leaders = __leaders_begin(lo);
+	bool is_leader = lo.leaders != MPI_COMM_NULL;
+	int root_node_rank = lo.node_of[root] == lo.node_of[comm.rank()] ?
+	    lo.node_rank_of[root] : -1;
+
+	// the buffers between the phases are set up by the first step
+	return __make_mpi_staged_assoc_state<void>(
+	    __hier_reduce_step<T, F>{
+	    { node, 0, p, nullptr, sz, f, tree_shape::binomial, 2, 0 },
+	    { leaders, lo.node_of[root], nullptr, nullptr, sz, f,
+	    tree_shape::binomial, 2, 0 },
+	    node, is_leader, root_node_rank, q, 0 });
+}
+
+template <typename T, typename F>
+inline
+future<void>
+hier_allreduce(communicator comm, T const* p, T* q, size_t sz, F f)
+{
+	auto& lo = __node_begin(comm);
+	auto node = __coll_begin(communicator(lo.node));
+
+	// the reduction and the broadcast within the node share the tag
+	return __make_mpi_staged_assoc_state<void>(
+	    __hier_allreduce_step<T, F>{
+	    { node, 0, p, q, sz, f, tree_shape::binomial, 2, 0 },
+	    { __leaders_begin(lo), q, q, sz, f, 0 },
+	    { node, 0, q, sz, tree_shape::binomial, 2, 0 },
+	    lo.leaders != MPI_COMM_NULL, 0 });
+}
+
+template <typename T>
+inline
+future<void>
+hier_bcast(communicator comm, int root, T* p, size_t sz)
+{
+	auto& lo = __node_begin(comm);
+	bool root_node = lo.node_of[root] == lo.node_of[comm.rank()];
+
+	return __make_mpi_staged_assoc_state<void>(
+	    __hier_bcast_step<T>{
+	    { __coll_begin(communicator(lo.node)),
+	    root_node ? lo.node_rank_of[root] : 0, p, sz,
+	    tree_shape::binomial, 2, 0 },
+	    { __leaders_begin(lo), lo.node_of[root], p, sz,
+	    tree_shape::binomial, 2, 0 },
+	    lo.leaders != MPI_COMM_NULL, root_node, 0 });
+}
+
+}
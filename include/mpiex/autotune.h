@@ -0,0 +1,255 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "operations.h"
+
+#include <type_traits>
+#include <vector>
+
+namespace mpiex
+{
+
+enum class coll_op
+{
+	reduce,
+	allreduce,
+	bcast
+};
+
+enum class coll_algorithm
+{
+	native,
+	ring,
+	binomial,
+	recursive_doubling,
+	hierarchical
+};
+
+// Collective.  The choice for op on messages of bytes, in the size class
+// of the same bit length, made on comm before or found in the cache file
+// by rank 0; false if it has to be measured.
+bool __tuned_find(communicator comm, coll_op op, size_t bytes,
+    coll_algorithm& a);
+
+// Collective.  The candidate taking the least time on its slowest rank,
+// remembered on comm and appended to the cache file by rank 0.
+coll_algorithm __tuned_pick(communicator comm, coll_op op, size_t bytes,
+    std::vector<coll_algorithm> const& cands, std::vector<double> times);
+
+inline
+std::vector<coll_algorithm>
+__tuned_candidates(coll_op op, bool native)
+{
+	std::vector<coll_algorithm> v;
+	if (native)
+		v.push_back(coll_algorithm::native);
+	if (op == coll_op::allreduce)
+		v.push_back(coll_algorithm::ring);
+	v.push_back(coll_algorithm::binomial);
+	if (op != coll_op::bcast)
+		v.push_back(coll_algorithm::recursive_doubling);
+	v.push_back(coll_algorithm::hierarchical);
+	return v;
+}
+
+template <typename Run>
+inline
+coll_algorithm
+__tuned_measure(communicator comm, coll_op op, size_t bytes, bool native,
+    Run run)
+{
+	auto cands = __tuned_candidates(op, native);
+	std::vector<double> times;
+
+	for (auto a : cands)
+	{
+		run(a).get();
+
+		auto t = MPI_Wtime();
+		for (int i = 0; i < tuning().autotune_reps; ++i)
+			run(a).get();
+		times.push_back(MPI_Wtime() - t);
+	}
+
+	return __tuned_pick(comm, op, bytes, cands, std::move(times));
+}
+
+// a choice of the native algorithm may have been made for another F
+template <typename T, typename F>
+inline
+future<void>
+__native_reduce(std::true_type, communicator comm, int root, T const* p,
+    T* q, size_t sz, F f)
+{
+	return reduce(comm, root, p, q, sz, f);
+}
+
+template <typename T, typename F>
+inline
+future<void>
+__native_reduce(std::false_type, communicator comm, int root, T const* p,
+    T* q, size_t sz, F f)
+{
+	return tree_reduce(comm, root, p, q, sz, f);
+}
+
+template <typename T, typename F>
+inline
+future<void>
+__native_allreduce(std::true_type, communicator comm, T const* p, T* q,
+    size_t sz, F f)
+{
+	return allreduce(comm, p, q, sz, f);
+}
+
+template <typename T, typename F>
+inline
+future<void>
+__native_allreduce(std::false_type, communicator comm, T const* p, T* q,
+    size_t sz, F f)
+{
+	return tree_allreduce(comm, p, q, sz, f);
+}
+
+template <typename T, typename F>
+inline
+future<void>
+__reduce_by(coll_algorithm a, communicator comm, int root, T const* p, T* q,
+    size_t sz, F f)
+{
+	switch (a)
+	{
+	case coll_algorithm::binomial:
+		return tree_reduce(comm, root, p, q, sz, f);
+	case coll_algorithm::recursive_doubling:
+		return tree_reduce(comm, root, p, q, sz, f,
+		    tree_shape::recursive_doubling);
+	case coll_algorithm::hierarchical:
+		return hier_reduce(comm, root, p, q, sz, f);
+	default:
+		return __native_reduce(__has_mpi_op<F>(), comm, root, p, q, sz,
+		    f);
+	}
+}
+
+template <typename T, typename F>
+inline
+future<void>
+__allreduce_by(coll_algorithm a, communicator comm, T const* p, T* q,
+    size_t sz, F f)
+{
+	switch (a)
+	{
+	case coll_algorithm::ring:
+		return allreduce_ring(comm, p, q, sz, f);
+	case coll_algorithm::binomial:
+		return tree_allreduce(comm, p, q, sz, f, tree_shape::binomial);
+	case coll_algorithm::recursive_doubling:
+		return tree_allreduce(comm, p, q, sz, f);
+	case coll_algorithm::hierarchical:
+		return hier_allreduce(comm, p, q, sz, f);
+	default:
+		return __native_allreduce(__has_mpi_op<F>(), comm, p, q, sz, f);
+	}
+}
+
+template <typename T>
+inline
+future<void>
+__bcast_by(coll_algorithm a, communicator comm, int root, T* p, size_t sz)
+{
+	switch (a)
+	{
+	case coll_algorithm::binomial:
+		return tree_bcast(comm, root, p, sz);
+	case coll_algorithm::hierarchical:
+		return hier_bcast(comm, root, p, sz);
+	default:
+		return bcast(comm, root, p, sz);
+	}
+}
+
+template <typename T, typename F>
+inline
+future<void>
+tuned_reduce(communicator comm, int root, T const* p, T* q, size_t sz, F f)
+{
+	coll_algorithm a;
+	if (!__tuned_find(comm, coll_op::reduce, sz * sizeof(T), a))
+	{
+		std::vector<T> x(p, p + sz), y(sz);
+		a = __tuned_measure(comm, coll_op::reduce, sz * sizeof(T),
+		    __has_mpi_op<F>::value, [&](coll_algorithm c)
+		    {
+			return __reduce_by(c, comm, root, x.data(), y.data(),
+			    sz, f);
+		    });
+	}
+
+	return __reduce_by(a, comm, root, p, q, sz, f);
+}
+
+template <typename T, typename F>
+inline
+future<void>
+tuned_allreduce(communicator comm, T const* p, T* q, size_t sz, F f)
+{
+	coll_algorithm a;
+	if (!__tuned_find(comm, coll_op::allreduce, sz * sizeof(T), a))
+	{
+		std::vector<T> x(p, p + sz), y(sz);
+		a = __tuned_measure(comm, coll_op::allreduce, sz * sizeof(T),
+		    __has_mpi_op<F>::value, [&](coll_algorithm c)
+		    {
+			return __allreduce_by(c, comm, x.data(), y.data(), sz,
+			    f);
+		    });
+	}
+
+	return __allreduce_by(a, comm, p, q, sz, f);
+}
+
+template <typename T>
+inline
+future<void>
+tuned_bcast(communicator comm, int root, T* p, size_t sz)
+{
+	coll_algorithm a;
+	if (!__tuned_find(comm, coll_op::bcast, sz * sizeof(T), a))
+	{
+		std::vector<T> x(p, p + sz);
+		a = __tuned_measure(comm, coll_op::bcast, sz * sizeof(T), true,
+		    [&](coll_algorithm c)
+		    {
+			return __bcast_by(c, comm, root, x.data(), sz);
+		    });
+	}
+
+	return __bcast_by(a, comm, root, p, sz);
+}
+
+}
@@ -27,9 +27,13 @@
 
 #include <mpi.h>
 
+#include <memory>
+
 namespace mpiex
 {
 
+struct shared_communicator;
+
 struct communicator
 {
 	communicator() : communicator(MPI_COMM_WORLD)
@@ -57,8 +61,50 @@ struct communicator
 		return comm_;
 	}
 
+	// collective; the results own their MPI_Comm
+	shared_communicator dup() const;
+	shared_communicator split(int color, int key = 0) const;
+	shared_communicator split_type(int type = MPI_COMM_TYPE_SHARED,
+	    int key = 0) const;
+
 private:
 	MPI_Comm comm_;
 };
 
+struct __comm_owner
+{
+	MPI_Comm comm;
+
+	// unless predefined, or after MPI_Finalize
+	~__comm_owner();
+};
+
+// A communicator freed with its last copy, which knows its rank and size
+// without asking MPI.  MPI_COMM_NULL has the rank MPI_UNDEFINED and the
+// size 0.
+struct shared_communicator : communicator
+{
+	// MPI_COMM_WORLD, which is never freed
+	shared_communicator() : shared_communicator(MPI_COMM_WORLD)
+	{}
+
+	// takes the ownership of comm
+	explicit shared_communicator(MPI_Comm comm);
+
+	int rank() const
+	{
+		return rank_;
+	}
+
+	int size() const
+	{
+		return size_;
+	}
+
+private:
+	std::shared_ptr<__comm_owner> owner_;
+	int rank_;
+	int size_;
+};
+
 }
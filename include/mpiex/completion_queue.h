@@ -0,0 +1,95 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <mpi.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <utility>
+
+namespace mpiex
+{
+
+struct completion
+{
+	std::uint64_t tag;
+	MPI_Status status;
+};
+
+// Batched completion of in-flight requests: each request is posted together
+// with a user tag, and poll() harvests the finished ones with one
+// MPI_Testsome.  No shared state is allocated per operation, and there is
+// no locking; a completion_queue shall be used from one thread at a time.
+struct completion_queue
+{
+	completion_queue() = default;
+	completion_queue(completion_queue const&) = delete;
+	completion_queue& operator=(completion_queue const&) = delete;
+
+	// waits for all the outstanding requests
+	~completion_queue();
+
+	void post(std::uint64_t tag, MPI_Request r);
+
+	template <typename F, typename... Args>
+	void post(std::uint64_t tag, F&& f, Args&&... args)
+	{
+		post(tag, MPI_Request(std::forward<F>(f)(
+		    std::forward<Args>(args)...)));
+	}
+
+	size_t poll(completion* out, size_t max_n);
+
+	std::vector<completion> poll(size_t max_n)
+	{
+		std::vector<completion> v(max_n);
+		v.resize(poll(v.data(), max_n));
+		return v;
+	}
+
+	// the number of requests not yet returned from poll()
+	size_t size() const
+	{
+		return reqs_.size() + done_.size();
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+private:
+	std::vector<MPI_Request> reqs_;
+	std::vector<std::uint64_t> tags_;
+	std::vector<int> indices_;
+	std::vector<MPI_Status> statuses_;
+	std::deque<completion> done_;
+};
+
+}
@@ -0,0 +1,364 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "algorithms.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace mpiex
+{
+
+enum class compression
+{
+	fp16,
+	bf16,
+	int8
+};
+
+// elements sharing a scale in the int8 encoding
+constexpr size_t __int8_block = 256;
+
+inline
+size_t
+__encoded_size(compression c, size_t n)
+{
+	if (c == compression::int8)
+		return (n + __int8_block - 1) / __int8_block * sizeof(float) + n;
+	return 2 * n;
+}
+
+// IEEE binary16, rounding to nearest even
+inline
+uint16_t
+__to_fp16(float x)
+{
+	uint32_t b;
+	std::memcpy(&b, &x, sizeof(b));
+
+	uint32_t sign = (b >> 16) & 0x8000;
+	int exp = int((b >> 23) & 0xff) - 127 + 15;
+	uint32_t man = b & 0x7fffff;
+
+	if (((b >> 23) & 0xff) == 0xff)
+		return uint16_t(sign | 0x7c00 | (man ? 0x200 : 0));
+	if (exp >= 31)
+		return uint16_t(sign | 0x7c00);
+	if (exp < -10)
+		return uint16_t(sign);
+
+	int shift = 13;
+	if (exp <= 0)
+	{
+		man |= 0x800000;
+		shift = 14 - exp;
+		exp = 0;
+	}
+
+	uint32_t h = (uint32_t(exp) << 10) | (man >> shift);
+	uint32_t rem = man & ((1u << shift) - 1);
+	uint32_t half = 1u << (shift - 1);
+
+	// a carry out of the mantissa bumps the exponent, up to infinity
+	if (rem > half || (rem == half && (h & 1)))
+		++h;
+	return uint16_t(sign | h);
+}
+
+inline
+float
+__from_fp16(uint16_t h)
+{
+	uint32_t sign = uint32_t(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1f;
+	uint32_t man = h & 0x3ff;
+	uint32_t b;
+
+	if (exp == 0x1f)
+		b = sign | 0x7f800000 | (man << 13);
+	else if (exp != 0)
+		b = sign | ((exp + 112) << 23) | (man << 13);
+	else
+	{
+		float x = float(man) * (1.0f / 16777216.0f);
+		std::memcpy(&b, &x, sizeof(b));
+		b |= sign;
+	}
+
+	float x;
+	std::memcpy(&x, &b, sizeof(x));
+	return x;
+}
+
+// the upper half of binary32, rounding to nearest even
+inline
+uint16_t
+__to_bf16(float x)
+{
+	uint32_t b;
+	std::memcpy(&b, &x, sizeof(b));
+
+	if ((b & 0x7fffffff) > 0x7f800000)
+		return uint16_t((b >> 16) | 0x40);
+	b += 0x7fff + ((b >> 16) & 1);
+	return uint16_t(b >> 16);
+}
+
+inline
+float
+__from_bf16(uint16_t h)
+{
+	uint32_t b = uint32_t(h) << 16;
+	float x;
+	std::memcpy(&x, &b, sizeof(x));
+	return x;
+}
+
+// The kernels are plain loops over contiguous arrays, for the compiler to
+// vectorize; the fp16 ones use the F16C instructions when available.
+template <typename T>
+inline
+void
+__encode(compression c, T const* x, size_t n, unsigned char* out)
+{
+	if (c == compression::int8)
+	{
+		for (size_t i = 0; i < n; i += __int8_block)
+		{
+			auto m = std::min(__int8_block, n - i);
+			float amax = 0;
+			for (size_t j = 0; j < m; ++j)
+				amax = std::max(amax, float(std::abs(x[i + j])));
+
+			float scale = amax / 127;
+			float inv = amax == 0 ? 0 : 127 / amax;
+			std::memcpy(out, &scale, sizeof(scale));
+			out += sizeof(scale);
+
+			auto v = reinterpret_cast<signed char*>(out);
+			for (size_t j = 0; j < m; ++j)
+			{
+				float y = float(x[i + j]) * inv;
+				v[j] = (signed char)(y + (y < 0 ? -0.5f : 0.5f));
+			}
+			out += m;
+		}
+		return;
+	}
+
+	std::vector<uint16_t> h(n);
+	size_t i = 0;
+
+	if (c == compression::bf16)
+		for (; i < n; ++i)
+			h[i] = __to_bf16(float(x[i]));
+#if defined(__F16C__)
+	else if (std::is_same<T, float>::value)
+		for (; i + 8 <= n; i += 8)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&h[i]),
+			    _mm256_cvtps_ph(_mm256_loadu_ps(
+			    reinterpret_cast<float const*>(x + i)), 0));
+#endif
+
+	for (; i < n; ++i)
+		h[i] = __to_fp16(float(x[i]));
+	std::memcpy(out, h.data(), 2 * n);
+}
+
+template <typename T>
+inline
+void
+__decode(compression c, unsigned char const* in, size_t n, T* x)
+{
+	if (c == compression::int8)
+	{
+		for (size_t i = 0; i < n; i += __int8_block)
+		{
+			auto m = std::min(__int8_block, n - i);
+			float scale;
+			std::memcpy(&scale, in, sizeof(scale));
+			in += sizeof(scale);
+
+			auto v = reinterpret_cast<signed char const*>(in);
+			for (size_t j = 0; j < m; ++j)
+				x[i + j] = T(v[j] * scale);
+			in += m;
+		}
+		return;
+	}
+
+	std::vector<uint16_t> h(n);
+	std::memcpy(h.data(), in, 2 * n);
+	size_t i = 0;
+
+	if (c == compression::bf16)
+		for (; i < n; ++i)
+			x[i] = T(__from_bf16(h[i]));
+#if defined(__F16C__)
+	else if (std::is_same<T, float>::value)
+		for (; i + 8 <= n; i += 8)
+			_mm256_storeu_ps(reinterpret_cast<float*>(x + i),
+			    _mm256_cvtph_ps(_mm_loadu_si128(
+			    reinterpret_cast<__m128i const*>(&h[i]))));
+#endif
+
+	for (; i < n; ++i)
+		x[i] = T(__from_fp16(h[i]));
+}
+
+// The ring of allreduce_ring, with one message per segment and step.  The
+// partial sums are decoded and reduced in full precision, and encoded again
+// to be forwarded; the final segments are encoded once by their owners and
+// forwarded as they are, so that all the ranks decode the same result.
+template <typename T, typename F>
+struct __compressed_ring_step
+{
+	__coll_channel ch;
+	T* q;
+	size_t sz;
+	F f;
+	compression c;
+	int step;
+	std::vector<unsigned char> sbuf;
+	std::vector<unsigned char> rbuf;
+	std::vector<T> tmp;
+
+	size_t offset(int i) const
+	{
+		auto n = size_t(ch.size);
+		auto k = size_t(i);
+		return k * (sz / n) + std::min(k, sz % n);
+	}
+
+	size_t length(int i) const
+	{
+		return offset(i + 1) - offset(i);
+	}
+
+	bool operator()(std::vector<MPI_Request>& reqs)
+	{
+		auto n = ch.size;
+		int last = 2 * (n - 1);
+
+		if (step == 0)
+		{
+			sbuf.resize(__encoded_size(c, offset(1)));
+			rbuf.resize(sbuf.size());
+			tmp.resize(offset(1));
+		}
+		else if (step < n)
+		{
+			// reduce-scatter
+			int r = (ch.rank - step + n) % n;
+			auto qr = q + offset(r);
+			__decode(c, rbuf.data(), length(r), tmp.data());
+			for (size_t i = 0; i < length(r); ++i)
+				qr[i] = f(qr[i], tmp[i]);
+
+			if (step == n - 1)
+			{
+				__encode(c, qr, length(r), sbuf.data());
+				__decode(c, sbuf.data(), length(r), qr);
+			}
+		}
+		else
+		{
+			// allgather
+			int r = (ch.rank - (step - n) + n) % n;
+			__decode(c, rbuf.data(), length(r), q + offset(r));
+			sbuf.swap(rbuf);
+		}
+
+		if (step < last)
+		{
+			int s = step < n - 1 ? (ch.rank - step + n) % n :
+			    (ch.rank + 1 - (step - n + 1) + n) % n;
+			int r = step < n - 1 ? (ch.rank - step - 1 + n) % n :
+			    (ch.rank - (step - n + 1) + n) % n;
+
+			if (step < n - 1)
+				__encode(c, q + offset(s), length(s), sbuf.data());
+
+			MPI_Request req;
+			MPI_Irecv(rbuf.data(), int(__encoded_size(c, length(r))),
+			    MPI_BYTE, (ch.rank + n - 1) % n, ch.tag, ch.comm, &req);
+			reqs.push_back(req);
+			MPI_Isend(sbuf.data(), int(__encoded_size(c, length(s))),
+			    MPI_BYTE, (ch.rank + 1) % n, ch.tag, ch.comm, &req);
+			reqs.push_back(req);
+		}
+
+		return step++ < last;
+	}
+};
+
+template <typename T, typename F>
+inline
+future<void>
+allreduce_compressed(communicator comm, T const* p, T* q, size_t sz, F f,
+    compression c, T* residual = nullptr)
+{
+	static_assert(std::is_floating_point<T>::value,
+	    "only floating-point arrays can be compressed");
+
+	auto ch = __coll_begin(comm);
+	__compressed_ring_step<T, F> step{ ch, q, sz, f, c, 0 };
+
+	if (residual == nullptr)
+	{
+		if (p != q)
+			std::copy_n(p, sz, q);
+	}
+	else
+	{
+		// error feedback: what the encoding of the input loses now is
+		// added to the input next time; encoded by the same segments,
+		// the input passes the first hop exactly
+		std::vector<T> x(sz);
+		std::vector<unsigned char> e(__encoded_size(c, step.offset(1)));
+		for (size_t i = 0; i < sz; ++i)
+			x[i] = p[i] + residual[i];
+		for (int i = 0; i < ch.size; ++i)
+		{
+			auto k = step.offset(i);
+			__encode(c, x.data() + k, step.length(i), e.data());
+			__decode(c, e.data(), step.length(i), q + k);
+		}
+		for (size_t i = 0; i < sz; ++i)
+			residual[i] = x[i] - q[i];
+	}
+
+	return __make_mpi_staged_assoc_state<void>(std::move(step));
+}
+
+}
@@ -0,0 +1,135 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "operations.h"
+#include "window.h"
+
+#include <algorithm>
+
+namespace mpiex
+{
+
+// A long integer in an RMA window on one process, which every process
+// can fetch and add to atomically, without the involvement of its home.
+struct global_counter
+{
+	// collective
+	explicit global_counter(communicator comm, long init = 0,
+	    int home = 0) :
+		home_(home), win_(comm, comm.rank() == home ? 1 : 0)
+	{
+		if (comm.rank() == home)
+			*win_.data() = init;
+		win_.sync();
+		barrier(comm).get();
+	}
+
+	// the value before the addition
+	future<long> fetch_add(long n)
+	{
+		return __fetch(n, MPI_SUM);
+	}
+
+	future<long> load()
+	{
+		return __fetch(0, MPI_NO_OP);
+	}
+
+private:
+	future<long> __fetch(long n, MPI_Op op)
+	{
+		auto w = win_.get();
+		auto home = home_;
+		return mpi_async<long>([=](long& v)
+		    {
+			MPI_Request r;
+			MPI_Rget_accumulate(&n, 1, MPI_LONG, &v, 1, MPI_LONG,
+			    home, 0, 1, MPI_LONG, op, w, &r);
+			return r;
+		    });
+	}
+
+	int home_;
+	window<long> win_;
+};
+
+enum class loop_schedule
+{
+	fixed,
+	guided,
+	adaptive
+};
+
+// Collective.  Every process claims chunks of [0, n) from a counter, and
+// calls f(first, last) on each, the claim of the next chunk overlapping
+// the work on the current one.  Returns the number of the iterations run
+// by the calling process.
+template <typename F>
+inline
+long
+dynamic_for(communicator comm, long n, F f,
+    loop_schedule s = loop_schedule::guided, long chunk = 1)
+{
+	global_counter c(comm);
+	long p = comm.size();
+	chunk = std::max(chunk, 1L);	// an empty claim never advances
+	long done = 0;
+	double rate = 0;	// seconds per iteration
+
+	auto size_after = [&](long seen)
+	{
+		long k = chunk;
+		if (s != loop_schedule::fixed)
+			k = std::max(chunk, (n - seen) / (2 * p));
+		if (s == loop_schedule::adaptive && rate > 0)
+			k = std::max(chunk, std::min(k,
+			    long(tuning().loop_chunk_time / rate)));
+		return k;
+	};
+
+	long k = size_after(0);
+	auto next = c.fetch_add(k);
+	for (;;)
+	{
+		long first = next.get();
+		if (first >= n)
+			break;
+
+		long last = std::min(n, first + k);
+		k = size_after(last);
+		next = c.fetch_add(k);
+
+		auto t = MPI_Wtime();
+		f(first, last);
+		rate = (MPI_Wtime() - t) / double(last - first);
+		done += last - first;
+	}
+
+	return done;
+}
+
+}
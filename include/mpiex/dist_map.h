@@ -0,0 +1,381 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "operations.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mpiex
+{
+
+// The batches of a dist_unordered_map are applied in the order they were
+// made, although each one reaches its turn whenever its future is polled.
+// A batch which arrives early parks on a generalized request, which the
+// batch before it completes once applied.
+struct __dist_map_order
+{
+	std::mutex mut;
+	unsigned long issued = 0;
+	unsigned long applied = 0;
+	std::map<unsigned long, MPI_Request> parked;
+
+	// false if the batch shall wait on *r first
+	bool try_apply(unsigned long ticket, MPI_Request* r)
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		if (applied == ticket)
+			return true;
+
+		MPI_Grequest_start(__query, __free, __cancel, nullptr, r);
+		parked[ticket] = *r;
+		return false;
+	}
+
+	void done(unsigned long ticket)
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		applied = ticket + 1;
+		auto it = parked.find(applied);
+		if (it != parked.end())
+		{
+			MPI_Grequest_complete(it->second);
+			parked.erase(it);
+		}
+	}
+
+	static int __query(void*, MPI_Status* st)
+	{
+		MPI_Status_set_elements(st, MPI_BYTE, 0);
+		MPI_Status_set_cancelled(st, 0);
+		st->MPI_SOURCE = MPI_UNDEFINED;
+		st->MPI_TAG = MPI_UNDEFINED;
+		return MPI_SUCCESS;
+	}
+
+	static int __free(void*)
+	{
+		return MPI_SUCCESS;
+	}
+
+	static int __cancel(void*, int)
+	{
+		return MPI_SUCCESS;
+	}
+};
+
+// A batch of operations on a dist_unordered_map: the counts first, by an
+// MPI_Ialltoall as in alltoallv, then one message of the requests to each
+// owner, and one message of the responses back, on the private channel.
+// The responses land in the order of the requests sent, which order
+// records the positions of in the batch.
+template <typename K, typename V, typename H, bool Insert>
+struct __dist_map_step
+{
+	using result_type = typename std::conditional<Insert,
+	    std::vector<bool>, std::vector<std::pair<bool, V>>>::type;
+
+	std::shared_ptr<std::unordered_map<K, V, H>> map;
+	std::shared_ptr<__dist_map_order> seq;
+	unsigned long ticket;
+	communicator comm;
+	__coll_channel ch;
+	std::vector<size_t> order;
+	std::vector<int> scounts, sdispls;
+	std::vector<K> skeys;
+	std::vector<V> svals;	// with Insert only
+	int stage;
+	std::vector<int> rcounts, rdispls;
+	std::vector<K> rkeys;
+	std::vector<V> rvals;
+	std::vector<char> flags, rflags;	// responses, sent and received
+	std::vector<V> found, rfound;	// without Insert only
+
+	bool operator()(result_type& res, std::vector<MPI_Request>& reqs)
+	{
+		MPI_Request r;
+
+		switch (stage++)
+		{
+		case 0:
+			rcounts.resize(ch.size);
+			MPI_Ialltoall(scounts.data(), 1, MPI_INT, rcounts.data(),
+			    1, MPI_INT, comm.get(), &r);
+			reqs.push_back(r);
+			return true;
+
+		case 1:
+			rdispls = __displs_of(rcounts);
+			rkeys.resize(size_t(rdispls.back() + rcounts.back()));
+			if (Insert)
+				rvals.resize(rkeys.size());
+
+			for (int i = 0; i < ch.size; ++i)
+			{
+				if (Insert)
+					__exchange(reqs, i,
+					    skeys.data() + sdispls[i],
+					    svals.data() + sdispls[i],
+					    scounts[i],
+					    rkeys.data() + rdispls[i],
+					    rvals.data() + rdispls[i],
+					    rcounts[i]);
+				else
+					__exchange(reqs, i,
+					    skeys.data() + sdispls[i],
+					    scounts[i],
+					    rkeys.data() + rdispls[i],
+					    rcounts[i]);
+			}
+			return true;
+
+		case 2:
+			if (!seq->try_apply(ticket, &r))
+			{
+				reqs.push_back(r);
+				--stage;
+				return true;
+			}
+
+			// apply in the order of the ranks of the requesters
+			flags.resize(rkeys.size());
+			if (!Insert)
+				found.resize(rkeys.size());
+			for (size_t j = 0; j < rkeys.size(); ++j)
+				__apply(j);
+			seq->done(ticket);
+
+			rflags.resize(skeys.size());
+			if (!Insert)
+				rfound.resize(skeys.size());
+			for (int i = 0; i < ch.size; ++i)
+			{
+				if (Insert)
+					__exchange(reqs, i,
+					    flags.data() + rdispls[i],
+					    rcounts[i],
+					    rflags.data() + sdispls[i],
+					    scounts[i]);
+				else
+					__exchange(reqs, i,
+					    flags.data() + rdispls[i],
+					    found.data() + rdispls[i],
+					    rcounts[i],
+					    rflags.data() + sdispls[i],
+					    rfound.data() + sdispls[i],
+					    scounts[i]);
+			}
+			return true;
+
+		default:
+			res.resize(order.size());
+			__collect(res);
+			return false;
+		}
+	}
+
+	template <typename T>
+	void __exchange(std::vector<MPI_Request>& reqs, int peer, T* sp,
+	    int sn, T* rp, int rn)
+	{
+		MPI_Request r;
+		if (rn != 0)
+		{
+			MPI_Irecv(rp, rn, mpi_type_of<T>{}, peer, ch.tag, ch.comm,
+			    &r);
+			reqs.push_back(r);
+		}
+		if (sn != 0)
+		{
+			MPI_Isend(sp, sn, mpi_type_of<T>{}, peer, ch.tag, ch.comm,
+			    &r);
+			reqs.push_back(r);
+		}
+	}
+
+	// sn pairs of *sa and *sb as one message, by a struct datatype over
+	// their absolute addresses
+	template <typename A, typename B>
+	void __exchange(std::vector<MPI_Request>& reqs, int peer, A* sa,
+	    B* sb, int sn, A* ra, B* rb, int rn)
+	{
+		MPI_Request r;
+		MPI_Datatype t;
+		if (rn != 0)
+		{
+			t = __pair_type(ra, rb, rn);
+			MPI_Irecv(MPI_BOTTOM, 1, t, peer, ch.tag, ch.comm, &r);
+			MPI_Type_free(&t);
+			reqs.push_back(r);
+		}
+		if (sn != 0)
+		{
+			t = __pair_type(sa, sb, sn);
+			MPI_Isend(MPI_BOTTOM, 1, t, peer, ch.tag, ch.comm, &r);
+			MPI_Type_free(&t);
+			reqs.push_back(r);
+		}
+	}
+
+	template <typename A, typename B>
+	static MPI_Datatype __pair_type(A* a, B* b, int n)
+	{
+		int lens[] = { n, n };
+		MPI_Aint addrs[2];
+		MPI_Get_address(a, &addrs[0]);
+		MPI_Get_address(b, &addrs[1]);
+		MPI_Datatype types[] = { mpi_type_of<A>{}, mpi_type_of<B>{} };
+
+		MPI_Datatype t;
+		MPI_Type_create_struct(2, lens, addrs, types, &t);
+		MPI_Type_commit(&t);
+		return t;
+	}
+
+	void __apply(size_t j)
+	{
+		__apply(j, std::integral_constant<bool, Insert>());
+	}
+
+	void __apply(size_t j, std::true_type)
+	{
+		flags[j] = map->emplace(rkeys[j], rvals[j]).second;
+	}
+
+	void __apply(size_t j, std::false_type)
+	{
+		auto it = map->find(rkeys[j]);
+		flags[j] = it != map->end();
+		if (flags[j])
+			found[j] = it->second;
+	}
+
+	void __collect(std::vector<bool>& res)
+	{
+		for (size_t s = 0; s < order.size(); ++s)
+			res[order[s]] = rflags[s] != 0;
+	}
+
+	void __collect(std::vector<std::pair<bool, V>>& res)
+	{
+		for (size_t s = 0; s < order.size(); ++s)
+			res[order[s]] = { rflags[s] != 0, rfound[s] };
+	}
+};
+
+// A hash table of which every entry lives on the process the hash of its
+// key picks.  The operations are performed in collective batches.
+template <typename K, typename V, typename Hash = std::hash<K>>
+struct dist_unordered_map
+{
+	explicit dist_unordered_map(communicator comm = communicator()) :
+		comm_(comm), size_(comm.size()),
+		map_(std::make_shared<std::unordered_map<K, V, Hash>>()),
+		seq_(std::make_shared<__dist_map_order>())
+	{}
+
+	int owner(K const& k) const
+	{
+		return int(Hash()(k) % size_t(size_));
+	}
+
+	// collective; true where the key was new, as in emplace
+	future<std::vector<bool>>
+	insert(std::vector<std::pair<K, V>> const& items)
+	{
+		auto s = __make_step<true>(items.size(), [&](size_t i)
+		    {
+			return owner(items[i].first);
+		    });
+		s.skeys.resize(items.size());
+		s.svals.resize(items.size());
+		for (size_t j = 0; j < s.order.size(); ++j)
+		{
+			s.skeys[j] = items[s.order[j]].first;
+			s.svals[j] = items[s.order[j]].second;
+		}
+
+		return __make_mpi_staged_assoc_state<std::vector<bool>>(
+		    std::move(s));
+	}
+
+	// collective; the value of each key, if found
+	future<std::vector<std::pair<bool, V>>>
+	find(std::vector<K> const& keys)
+	{
+		auto s = __make_step<false>(keys.size(), [&](size_t i)
+		    {
+			return owner(keys[i]);
+		    });
+		s.skeys.resize(keys.size());
+		for (size_t j = 0; j < s.order.size(); ++j)
+			s.skeys[j] = keys[s.order[j]];
+
+		return __make_mpi_staged_assoc_state<
+		    std::vector<std::pair<bool, V>>>(std::move(s));
+	}
+
+	// the entries owned by the calling process; shall not be accessed
+	// while a batch is in progress
+	std::unordered_map<K, V, Hash> const& local() const
+	{
+		return *map_;
+	}
+
+private:
+	// buckets the positions of a batch by owner
+	template <bool Insert, typename F>
+	__dist_map_step<K, V, Hash, Insert> __make_step(size_t n, F owner_of)
+	{
+		__dist_map_step<K, V, Hash, Insert> s{ map_, seq_,
+		    seq_->issued++, comm_, __coll_begin(comm_) };
+		std::vector<int> dest(n);
+		s.scounts.resize(size_t(size_));
+		for (size_t i = 0; i < n; ++i)
+			++s.scounts[size_t(dest[i] = owner_of(i))];
+
+		s.sdispls = __displs_of(s.scounts);
+		auto next = s.sdispls;
+		s.order.resize(n);
+		for (size_t i = 0; i < n; ++i)
+			s.order[size_t(next[size_t(dest[i])]++)] = i;
+		return s;
+	}
+
+	communicator comm_;
+	int size_;
+	std::shared_ptr<std::unordered_map<K, V, Hash>> map_;
+	std::shared_ptr<__dist_map_order> seq_;
+};
+
+}
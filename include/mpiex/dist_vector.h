@@ -0,0 +1,211 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "window.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace mpiex
+{
+
+enum class distribution
+{
+	block,
+	cyclic
+};
+
+// A global array of n elements of T partitioned over a communicator, the
+// local part of each process in an RMA window.  With the block
+// distribution, the first n % P processes own one more element than the
+// others.
+template <typename T>
+struct dist_vector
+{
+	// collective
+	dist_vector(communicator comm, size_t n,
+	    distribution d = distribution::block) :
+		n_(n), p_(size_t(comm.size())), dist_(d),
+		win_(comm, __local_size(size_t(comm.rank())))
+	{}
+
+	size_t size() const
+	{
+		return n_;
+	}
+
+	distribution dist() const
+	{
+		return dist_;
+	}
+
+	int owner(size_t i) const
+	{
+		if (dist_ == distribution::cyclic)
+			return int(i % p_);
+
+		auto q = n_ / p_, r = n_ % p_;
+		if (i < (q + 1) * r)
+			return int(i / (q + 1));
+		return int(r + (i - (q + 1) * r) / q);
+	}
+
+	// in the local part of the owner
+	size_t local_index(size_t i) const
+	{
+		if (dist_ == distribution::cyclic)
+			return i / p_;
+		return i - __first_of(size_t(owner(i)));
+	}
+
+	size_t global_index(int rank, size_t k) const
+	{
+		if (dist_ == distribution::cyclic)
+			return k * p_ + size_t(rank);
+		return __first_of(size_t(rank)) + k;
+	}
+
+	T* local_data() const
+	{
+		return win_.data();
+	}
+
+	size_t local_size() const
+	{
+		return win_.size();
+	}
+
+	// one RMA operation for each owner of [first, first + sz)
+	future<void> get(size_t first, size_t sz, T* p)
+	{
+		return __each_owner(first, sz, p,
+		    [](void* o, int oc, MPI_Datatype ot, int r, size_t disp,
+			int c, MPI_Win w, MPI_Request* req)
+		    {
+			MPI_Rget(o, oc, ot, r, MPI_Aint(disp), c,
+			    mpi_type_of<T>{}, w, req);
+		    });
+	}
+
+	// ready once the source can be reused; see flush()
+	future<void> put(size_t first, size_t sz, T const* p)
+	{
+		return __each_owner(first, sz, const_cast<T*>(p),
+		    [](void* o, int oc, MPI_Datatype ot, int r, size_t disp,
+			int c, MPI_Win w, MPI_Request* req)
+		    {
+			MPI_Rput(o, oc, ot, r, MPI_Aint(disp), c,
+			    mpi_type_of<T>{}, w, req);
+		    });
+	}
+
+	// completes the puts of the calling process at their targets
+	future<void> flush()
+	{
+		return win_.flush_all();
+	}
+
+	// makes the completed puts of the others visible to the local view
+	void sync()
+	{
+		win_.sync();
+	}
+
+	window<T>& win()
+	{
+		return win_;
+	}
+
+private:
+	size_t __first_of(size_t rank) const
+	{
+		auto q = n_ / p_, r = n_ % p_;
+		return rank * q + std::min(rank, r);
+	}
+
+	// the same for both distributions
+	size_t __local_size(size_t rank) const
+	{
+		return n_ / p_ + (rank < n_ % p_);
+	}
+
+	template <typename F>
+	future<void> __each_owner(size_t first, size_t sz, T* p, F op)
+	{
+		std::vector<MPI_Request> reqs;
+		MPI_Request r;
+		auto w = win_.get();
+		auto last = first + sz;
+
+		if (sz != 0 && dist_ == distribution::block)
+		{
+			for (auto i = first; i < last;)
+			{
+				auto o = owner(i);
+				auto end = std::min(last,
+				    __first_of(size_t(o)) + __local_size(size_t(o)));
+				auto c = int(end - i);
+				op(p + (i - first), c, mpi_type_of<T>{}, o,
+				    local_index(i), c, w, &r);
+				reqs.push_back(r);
+				i = end;
+			}
+		}
+		else if (sz != 0)
+		{
+			// the elements of an owner are strided in p and
+			// consecutive on the owner
+			for (size_t k = 0; k < std::min(p_, sz); ++k)
+			{
+				auto i = first + k;
+				auto c = int((last - 1 - i) / p_ + 1);
+				MPI_Datatype t;
+				MPI_Type_vector(c, 1, int(p_), mpi_type_of<T>{},
+				    &t);
+				MPI_Type_commit(&t);
+				op(p + k, 1, t, owner(i), local_index(i), c, w,
+				    &r);
+				MPI_Type_free(&t);
+				reqs.push_back(r);
+			}
+		}
+
+		return __make_mpi_staged_assoc_state<void>(
+		    [reqs = std::move(reqs)](std::vector<MPI_Request>& v)
+		    {
+			v = reqs;
+			return false;
+		    });
+	}
+
+	size_t n_;
+	size_t p_;
+	distribution dist_;
+	window<T> win_;
+};
+
+}
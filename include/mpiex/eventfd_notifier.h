@@ -0,0 +1,84 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "future.h"
+
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <vector>
+
+namespace mpiex
+{
+
+// Signals a Linux eventfd when any of the watched futures becomes ready, so
+// that MPI completions can be multiplexed with sockets in one epoll loop.
+// Readiness is tested by a helper thread owned by the notifier; to watch
+// MPI futures, MPI shall be initialized with MPI_THREAD_MULTIPLE.
+struct eventfd_notifier
+{
+	explicit eventfd_notifier(std::chrono::microseconds interval =
+	    std::chrono::microseconds(100));
+	eventfd_notifier(eventfd_notifier const&) = delete;
+	eventfd_notifier& operator=(eventfd_notifier const&) = delete;
+	~eventfd_notifier();
+
+	int fd() const
+	{
+		return fd_;
+	}
+
+	template <typename R>
+	void watch(shared_future<R> f, std::uint64_t tag)
+	{
+		watch(tag, [f] { return f.is_ready(); });
+	}
+
+	std::vector<std::uint64_t> poll();
+
+private:
+	struct entry
+	{
+		std::uint64_t tag;
+		std::function<bool()> is_ready;
+	};
+
+	void watch(std::uint64_t tag, std::function<bool()> is_ready);
+	void run();
+
+	int fd_;
+	std::chrono::microseconds interval_;
+	bool stop_ = false;
+	std::list<entry> watched_;
+	std::list<entry> fired_;
+	mutex mut_;
+	condition_variable cv_;
+	thread thr_;
+};
+
+}
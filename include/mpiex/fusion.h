@@ -0,0 +1,73 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "future.h"
+#include "traits.h"
+#include "communicator.h"
+
+#include <memory>
+
+namespace mpiex
+{
+
+struct __fusion_core;
+
+// Fuses small allreduce operations into one MPI_Iallreduce per type and
+// operator.  The operations are packed into the buffer until a byte budget
+// is reached, or flush() is called, or one of their futures is waited on;
+// these points are the same on all the ranks, if they make the same calls.
+struct fusion_buffer
+{
+	explicit fusion_buffer(communicator comm = communicator(),
+	    size_t budget = 64 * 1024);
+
+	fusion_buffer(fusion_buffer const&) = delete;
+	fusion_buffer& operator=(fusion_buffer const&) = delete;
+
+	// flushes, and waits for all the fused operations
+	~fusion_buffer();
+
+	template <typename T, typename F>
+	future<void> allreduce(T const* p, T* q, size_t sz, F)
+	{
+		return add(mpi_type_of<T>{}, mpi_op_of<F>{}, sizeof(T), p, q,
+		    sz);
+	}
+
+	void flush();
+
+	// bytes packed and not yet flushed
+	size_t size() const;
+
+private:
+	future<void> add(MPI_Datatype dt, MPI_Op op, size_t elem,
+	    void const* p, void* q, size_t sz);
+
+	std::shared_ptr<__fusion_core> core_;
+};
+
+}
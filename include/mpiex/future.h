@@ -367,6 +367,7 @@ template <class R, class Alloc> struct uses_allocator<packaged_task<R>, Alloc>;
 #include <condition_variable>
 #include <future>
 #include <stdexcept>
+#include <vector>
 
 namespace mpiex
 {
@@ -491,6 +492,7 @@ protected:
 
     virtual void __on_zero_shared() _NOEXCEPT;
     void __sub_wait(unique_lock<mutex>& __lk);
+    virtual void __sub_block(unique_lock<mutex>& __lk);
 public:
     enum
     {
@@ -521,12 +523,23 @@ public:
 
     void __make_ready();
     _LIBCPP_INLINE_VISIBILITY
-    bool is_ready() { return __is_ready(); }
+    bool is_ready()
+    {
+        lock_guard<mutex> __lk(__mut_);
+        return __is_ready();
+    }
+    // called with __mut_ held
     virtual bool __is_ready() {return (__state_ & ready) != 0;}
 
     void set_value();
 
     void set_exception(exception_ptr __p);
+    // called with __mut_ held
+    void __set_mpi_error(const char* __what)
+    {
+        __exception_ = make_exception_ptr(runtime_error(__what));
+        __state_ |= ready;
+    }
 
     void copy();
 
@@ -969,6 +982,28 @@ __async_assoc_state<void, _Fp>::__on_zero_shared() _NOEXCEPT
     base::__on_zero_shared();
 }
 
+// __mpi_progress
+
+// A multi-stage operation cannot complete inside the MPI library; it makes
+// progress only when it is tested.  Every pending one is registered here,
+// and blocking on any MPI future polls all of them, so that two ranks
+// waiting on different operations cannot starve each other.
+
+class _LIBCPP_TYPE_VIS __mpi_progress_node
+{
+public:
+    virtual void __poll() = 0;
+
+protected:
+    ~__mpi_progress_node() = default;
+};
+
+void __mpi_progress_register(__mpi_progress_node* __n);
+void __mpi_progress_unregister(__mpi_progress_node* __n);
+
+// returns false if there was nothing to poll
+bool __mpi_progress();
+
 // __mpi_assoc_state
 
 template <class _Rp, class _Fp>
@@ -988,7 +1023,7 @@ public:
 #endif
 
     virtual bool __is_ready() override;
-    virtual void __wait() override;
+    virtual void __sub_block(unique_lock<mutex>& __lk) override;
     virtual void __execute() override;
 };
 
@@ -997,7 +1032,7 @@ public:
 template <class _Rp, class _Fp>
 inline
 __mpi_assoc_state<_Rp, _Fp>::__mpi_assoc_state(_Fp&& __f)
-    : __func_(std::forward<_Fp>(__f))
+    : __func_(std::forward<_Fp>(__f)), __req_(MPI_REQUEST_NULL)
 {
 }
 
@@ -1008,6 +1043,7 @@ void
 __mpi_assoc_state<_Rp, _Fp>::__execute()
 {
     ::new(std::addressof(this->__value_)) _Rp;  // default ctor
+    this->__state_ |= base::__constructed;
     __req_ = __func_(*reinterpret_cast<_Rp*>(std::addressof(this->__value_)));
 }
 
@@ -1021,25 +1057,34 @@ __mpi_assoc_state<_Rp, _Fp>::__on_zero_shared() _NOEXCEPT
 
 template <class _Rp, class _Fp>
 void
-__mpi_assoc_state<_Rp, _Fp>::__wait()
-{
-    MPI_Status st;
-    // not thread-safe
-    // XXX needs polish
-    if (MPI_Wait(&__req_, &st) == MPI_SUCCESS)
+__mpi_assoc_state<_Rp, _Fp>::__sub_block(unique_lock<mutex>& __lk)
+{
+    // let the pending staged operations advance; they may be what the
+    // peer is waiting on before it can match this request
+    __lk.unlock();
+    bool __others = __mpi_progress();
+    __lk.lock();
+    if (__others)
+        return;
+    if (MPI_Wait(&__req_, MPI_STATUS_IGNORE) == MPI_SUCCESS)
         this->__state_ |= base::__constructed | base::ready;
     else
-        this->set_exception(make_exception_ptr(runtime_error("MPI_Wait")));
+        this->__set_mpi_error("MPI_Wait");
 }
 
 template <class _Rp, class _Fp>
 bool
 __mpi_assoc_state<_Rp, _Fp>::__is_ready()
 {
-    MPI_Status st;
-    int finished;
-    MPI_Test(&__req_, &finished, MPI_STATUS_IGNORE);
-    return finished;
+    if (!(this->__state_ & base::ready))
+    {
+        int finished;
+        if (MPI_Test(&__req_, &finished, MPI_STATUS_IGNORE) != MPI_SUCCESS)
+            this->__set_mpi_error("MPI_Test");
+        else if (finished)
+            this->__state_ |= base::__constructed | base::ready;
+    }
+    return (this->__state_ & base::ready) != 0;
 }
 
 template <class _Fp>
@@ -1059,7 +1104,7 @@ public:
 #endif
 
     virtual bool __is_ready() override;
-    virtual void __wait() override;
+    virtual void __sub_block(unique_lock<mutex>& __lk) override;
     virtual void __execute();
 };
 
@@ -1068,7 +1113,7 @@ public:
 template <class _Fp>
 inline
 __mpi_assoc_state<void, _Fp>::__mpi_assoc_state(_Fp&& __f)
-    : __func_(std::forward<_Fp>(__f))
+    : __func_(std::forward<_Fp>(__f)), __req_(MPI_REQUEST_NULL)
 {
 }
 
@@ -1091,25 +1136,458 @@ __mpi_assoc_state<void, _Fp>::__on_zero_shared() _NOEXCEPT
 
 template <class _Fp>
 void
-__mpi_assoc_state<void, _Fp>::__wait()
-{
-    MPI_Status st;
-    // not thread-safe
-    // XXX needs polish
-    if (MPI_Wait(&__req_, &st) == MPI_SUCCESS)
+__mpi_assoc_state<void, _Fp>::__sub_block(unique_lock<mutex>& __lk)
+{
+    __lk.unlock();
+    bool __others = __mpi_progress();
+    __lk.lock();
+    if (__others)
+        return;
+    if (MPI_Wait(&__req_, MPI_STATUS_IGNORE) == MPI_SUCCESS)
         __state_ |= __constructed | ready;
     else
-        this->set_exception(make_exception_ptr(runtime_error("MPI_Wait")));
+        __set_mpi_error("MPI_Wait");
 }
 
 template <class _Fp>
 bool
 __mpi_assoc_state<void, _Fp>::__is_ready()
 {
-    MPI_Status st;
-    int finished;
-    MPI_Test(&__req_, &finished, MPI_STATUS_IGNORE);
-    return finished;
+    if (!(__state_ & ready))
+    {
+        int finished;
+        if (MPI_Test(&__req_, &finished, MPI_STATUS_IGNORE) != MPI_SUCCESS)
+            __set_mpi_error("MPI_Test");
+        else if (finished)
+            __state_ |= __constructed | ready;
+    }
+    return (__state_ & ready) != 0;
+}
+
+// __mpi_staged_assoc_state
+
+// _Fp is invoked as __f(__r, __reqs) (or __f(__reqs) for void) once at the
+// start, and again each time all the requests it appended to __reqs have
+// completed.  It returns false when the requests it just posted, if any,
+// are the last ones.
+
+template <class _Rp, class _Fp>
+class __mpi_staged_assoc_state
+    : public __assoc_state<_Rp>, public __mpi_progress_node
+{
+    typedef __assoc_state<_Rp> base;
+
+    _Fp __func_;
+    std::vector<MPI_Request> __reqs_;
+    bool __more_;
+    bool __registered_;
+
+    void __step();
+    virtual void __on_zero_shared() _NOEXCEPT;
+protected:
+    virtual void __sub_block(unique_lock<mutex>& __lk) override;
+public:
+    _LIBCPP_INLINE_VISIBILITY
+    explicit __mpi_staged_assoc_state(_Fp&& __f);
+
+    virtual bool __is_ready() override;
+    virtual void __execute() override;
+    virtual void __poll() override;
+};
+
+template <class _Rp, class _Fp>
+inline
+__mpi_staged_assoc_state<_Rp, _Fp>::__mpi_staged_assoc_state(_Fp&& __f)
+    : __func_(std::forward<_Fp>(__f)), __more_(false), __registered_(false)
+{
+}
+
+template <class _Rp, class _Fp>
+void
+__mpi_staged_assoc_state<_Rp, _Fp>::__execute()
+{
+    ::new(std::addressof(this->__value_)) _Rp;  // default ctor
+    this->__state_ |= base::__constructed;
+    __more_ = __func_(*reinterpret_cast<_Rp*>(std::addressof(this->__value_)),
+                      __reqs_);
+    __mpi_progress_register(this);
+    __registered_ = true;
+}
+
+template <class _Rp, class _Fp>
+void
+__mpi_staged_assoc_state<_Rp, _Fp>::__step()
+{
+    __reqs_.clear();
+#ifndef _LIBCPP_NO_EXCEPTIONS
+    try
+    {
+#endif  // _LIBCPP_NO_EXCEPTIONS
+        __more_ = __func_(*reinterpret_cast<_Rp*>(std::addressof(this->__value_)),
+                          __reqs_);
+#ifndef _LIBCPP_NO_EXCEPTIONS
+    }
+    catch (...)
+    {
+        MPI_Waitall(int(__reqs_.size()), __reqs_.data(), MPI_STATUSES_IGNORE);
+        __reqs_.clear();
+        __more_ = false;
+        this->__exception_ = current_exception();
+        this->__state_ |= base::ready;
+    }
+#endif  // _LIBCPP_NO_EXCEPTIONS
+}
+
+template <class _Rp, class _Fp>
+bool
+__mpi_staged_assoc_state<_Rp, _Fp>::__is_ready()
+{
+    while (!(this->__state_ & base::ready))
+    {
+        int __flag;
+        if (MPI_Testall(int(__reqs_.size()), __reqs_.data(), &__flag,
+                        MPI_STATUSES_IGNORE) != MPI_SUCCESS)
+            this->__set_mpi_error("MPI_Testall");
+        else if (!__flag)
+            break;
+        else if (__more_)
+            __step();
+        else
+            this->__state_ |= base::ready;
+    }
+
+    if ((this->__state_ & base::ready) && __registered_)
+    {
+        __mpi_progress_unregister(this);
+        __registered_ = false;
+    }
+    return (this->__state_ & base::ready) != 0;
+}
+
+template <class _Rp, class _Fp>
+void
+__mpi_staged_assoc_state<_Rp, _Fp>::__sub_block(unique_lock<mutex>& __lk)
+{
+    __lk.unlock();
+    __mpi_progress();
+    std::this_thread::yield();
+    __lk.lock();
+}
+
+template <class _Rp, class _Fp>
+void
+__mpi_staged_assoc_state<_Rp, _Fp>::__poll()
+{
+    unique_lock<mutex> __lk(this->__mut_, std::try_to_lock);
+    if (__lk.owns_lock())
+        __is_ready();
+}
+
+template <class _Rp, class _Fp>
+void
+__mpi_staged_assoc_state<_Rp, _Fp>::__on_zero_shared() _NOEXCEPT
+{
+    this->__wait();
+    if (__registered_)
+        __mpi_progress_unregister(this);
+    base::__on_zero_shared();
+}
+
+template <class _Fp>
+class __mpi_staged_assoc_state<void, _Fp>
+    : public __assoc_sub_state, public __mpi_progress_node
+{
+    typedef __assoc_sub_state base;
+
+    _Fp __func_;
+    std::vector<MPI_Request> __reqs_;
+    bool __more_;
+    bool __registered_;
+
+    void __step();
+    virtual void __on_zero_shared() _NOEXCEPT;
+protected:
+    virtual void __sub_block(unique_lock<mutex>& __lk) override;
+public:
+    _LIBCPP_INLINE_VISIBILITY
+    explicit __mpi_staged_assoc_state(_Fp&& __f);
+
+    virtual bool __is_ready() override;
+    virtual void __execute() override;
+    virtual void __poll() override;
+};
+
+template <class _Fp>
+inline
+__mpi_staged_assoc_state<void, _Fp>::__mpi_staged_assoc_state(_Fp&& __f)
+    : __func_(std::forward<_Fp>(__f)), __more_(false), __registered_(false)
+{
+}
+
+template <class _Fp>
+void
+__mpi_staged_assoc_state<void, _Fp>::__execute()
+{
+    __more_ = __func_(__reqs_);
+    __mpi_progress_register(this);
+    __registered_ = true;
+}
+
+template <class _Fp>
+void
+__mpi_staged_assoc_state<void, _Fp>::__step()
+{
+    __reqs_.clear();
+#ifndef _LIBCPP_NO_EXCEPTIONS
+    try
+    {
+#endif  // _LIBCPP_NO_EXCEPTIONS
+        __more_ = __func_(__reqs_);
+#ifndef _LIBCPP_NO_EXCEPTIONS
+    }
+    catch (...)
+    {
+        MPI_Waitall(int(__reqs_.size()), __reqs_.data(), MPI_STATUSES_IGNORE);
+        __reqs_.clear();
+        __more_ = false;
+        __exception_ = current_exception();
+        __state_ |= ready;
+    }
+#endif  // _LIBCPP_NO_EXCEPTIONS
+}
+
+template <class _Fp>
+bool
+__mpi_staged_assoc_state<void, _Fp>::__is_ready()
+{
+    while (!(__state_ & ready))
+    {
+        int __flag;
+        if (MPI_Testall(int(__reqs_.size()), __reqs_.data(), &__flag,
+                        MPI_STATUSES_IGNORE) != MPI_SUCCESS)
+            __set_mpi_error("MPI_Testall");
+        else if (!__flag)
+            break;
+        else if (__more_)
+            __step();
+        else
+            __state_ |= __constructed | ready;
+    }
+
+    if ((__state_ & ready) && __registered_)
+    {
+        __mpi_progress_unregister(this);
+        __registered_ = false;
+    }
+    return (__state_ & ready) != 0;
+}
+
+template <class _Fp>
+void
+__mpi_staged_assoc_state<void, _Fp>::__sub_block(unique_lock<mutex>& __lk)
+{
+    __lk.unlock();
+    __mpi_progress();
+    std::this_thread::yield();
+    __lk.lock();
+}
+
+template <class _Fp>
+void
+__mpi_staged_assoc_state<void, _Fp>::__poll()
+{
+    unique_lock<mutex> __lk(__mut_, std::try_to_lock);
+    if (__lk.owns_lock())
+        __is_ready();
+}
+
+template <class _Fp>
+void
+__mpi_staged_assoc_state<void, _Fp>::__on_zero_shared() _NOEXCEPT
+{
+    this->__wait();
+    if (__registered_)
+        __mpi_progress_unregister(this);
+    base::__on_zero_shared();
+}
+
+// The state of an operation which the library starts at some later
+// point.  __f_(false) polls the operation, returning true once it has
+// completed, or throwing its error; __f_(true) starts it if it is not
+// started yet, and is called by the first blocking wait only, so that
+// polling never starts anything.  An operation never waited on is started
+// when its state is destroyed, as the other MPI futures complete theirs.
+template <class _Fp>
+class __mpi_pending_assoc_state
+    : public __assoc_sub_state
+{
+    typedef __assoc_sub_state base;
+
+    _Fp __f_;
+    bool __started_;
+
+    virtual void __on_zero_shared() _NOEXCEPT;
+protected:
+    virtual void __sub_block(unique_lock<mutex>& __lk) override;
+public:
+    _LIBCPP_INLINE_VISIBILITY
+    explicit __mpi_pending_assoc_state(_Fp&& __f)
+        : __f_(std::forward<_Fp>(__f)), __started_(false) {}
+
+    virtual bool __is_ready() override;
+};
+
+template <class _Fp>
+bool
+__mpi_pending_assoc_state<_Fp>::__is_ready()
+{
+    if (!(this->__state_ & base::ready))
+    {
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        try
+        {
+#endif  // _LIBCPP_NO_EXCEPTIONS
+            if (__f_(false))
+                this->__state_ |= base::__constructed | base::ready;
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        }
+        catch (...)
+        {
+            this->__exception_ = current_exception();
+            this->__state_ |= base::ready;
+        }
+#endif  // _LIBCPP_NO_EXCEPTIONS
+    }
+    return (this->__state_ & base::ready) != 0;
+}
+
+template <class _Fp>
+void
+__mpi_pending_assoc_state<_Fp>::__on_zero_shared() _NOEXCEPT
+{
+    if (!__started_ && !(this->__state_ & base::ready))
+    {
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        try
+        {
+#endif  // _LIBCPP_NO_EXCEPTIONS
+            __f_(true);
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        }
+        catch (...)
+        {
+        }
+#endif  // _LIBCPP_NO_EXCEPTIONS
+    }
+    base::__on_zero_shared();
+}
+
+template <class _Fp>
+void
+__mpi_pending_assoc_state<_Fp>::__sub_block(unique_lock<mutex>& __lk)
+{
+    bool __start = !__started_;
+    __started_ = true;
+    __lk.unlock();
+    if (__start)
+        __f_(true);
+    else
+    {
+        __mpi_progress();
+        std::this_thread::yield();
+    }
+    __lk.lock();
+}
+
+// The same, for an operation with a result: __f_(false, __r) stores the
+// result into __r, which is default-constructed, before it returns true.
+template <class _Rp, class _Fp>
+class __mpi_pending_value_assoc_state
+    : public __assoc_state<_Rp>
+{
+    typedef __assoc_state<_Rp> base;
+
+    _Fp __f_;
+    bool __started_;
+
+    _Rp& __value()
+        {return *reinterpret_cast<_Rp*>(std::addressof(this->__value_));}
+
+    virtual void __on_zero_shared() _NOEXCEPT;
+protected:
+    virtual void __sub_block(unique_lock<mutex>& __lk) override;
+public:
+    _LIBCPP_INLINE_VISIBILITY
+    explicit __mpi_pending_value_assoc_state(_Fp&& __f)
+        : __f_(std::forward<_Fp>(__f)), __started_(false)
+    {
+        ::new(std::addressof(this->__value_)) _Rp;  // default ctor
+        this->__state_ |= base::__constructed;
+    }
+
+    virtual bool __is_ready() override;
+};
+
+template <class _Rp, class _Fp>
+bool
+__mpi_pending_value_assoc_state<_Rp, _Fp>::__is_ready()
+{
+    if (!(this->__state_ & base::ready))
+    {
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        try
+        {
+#endif  // _LIBCPP_NO_EXCEPTIONS
+            if (__f_(false, __value()))
+                this->__state_ |= base::ready;
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        }
+        catch (...)
+        {
+            this->__exception_ = current_exception();
+            this->__state_ |= base::ready;
+        }
+#endif  // _LIBCPP_NO_EXCEPTIONS
+    }
+    return (this->__state_ & base::ready) != 0;
+}
+
+template <class _Rp, class _Fp>
+void
+__mpi_pending_value_assoc_state<_Rp, _Fp>::__on_zero_shared() _NOEXCEPT
+{
+    if (!__started_ && !(this->__state_ & base::ready))
+    {
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        try
+        {
+#endif  // _LIBCPP_NO_EXCEPTIONS
+            __f_(true, __value());
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        }
+        catch (...)
+        {
+        }
+#endif  // _LIBCPP_NO_EXCEPTIONS
+    }
+    base::__on_zero_shared();
+}
+
+template <class _Rp, class _Fp>
+void
+__mpi_pending_value_assoc_state<_Rp, _Fp>::__sub_block(unique_lock<mutex>& __lk)
+{
+    bool __start = !__started_;
+    __started_ = true;
+    __lk.unlock();
+    if (__start)
+        __f_(true, __value());
+    else
+    {
+        __mpi_progress();
+        std::this_thread::yield();
+    }
+    __lk.lock();
 }
 
 template <class _Rp> class _LIBCPP_TYPE_VIS_ONLY promise;
@@ -1139,6 +1617,18 @@ template <class _Rp, class _Fp>
 future<_Rp>
 __make_mpi_assoc_state(_Fp&& __f);
 
+template <class _Rp, class _Fp>
+future<_Rp>
+__make_mpi_staged_assoc_state(_Fp&& __f);
+
+template <class _Fp>
+future<void>
+__make_mpi_pending_assoc_state(_Fp&& __f);
+
+template <class _Rp, class _Fp>
+future<_Rp>
+__make_mpi_pending_value_assoc_state(_Fp&& __f);
+
 template <class _Rp>
 class _LIBCPP_TYPE_VIS_ONLY future
 {
@@ -1163,6 +1653,10 @@ class _LIBCPP_TYPE_VIS_ONLY future
 
     template <class _R1, class _Fp>
         friend future<_R1> __make_mpi_assoc_state(_Fp&& __f);
+    template <class _R1, class _Fp>
+        friend future<_R1> __make_mpi_staged_assoc_state(_Fp&& __f);
+    template <class _R1, class _Fp>
+        friend future<_R1> __make_mpi_pending_value_assoc_state(_Fp&& __f);
 
 public:
     _LIBCPP_INLINE_VISIBILITY
@@ -1199,6 +1693,9 @@ public:
     _LIBCPP_INLINE_VISIBILITY
     bool valid() const _NOEXCEPT {return __state_ != nullptr;}
 
+    _LIBCPP_INLINE_VISIBILITY
+    bool is_ready() const {return __state_->is_ready();}
+
     _LIBCPP_INLINE_VISIBILITY
     void wait() const {__state_->wait();}
     template <class _Rep, class _Period>
@@ -1269,6 +1766,8 @@ class _LIBCPP_TYPE_VIS_ONLY future<_Rp&>
 
     template <class _R1, class _Fp>
         friend future<_R1> __make_mpi_assoc_state(_Fp&& __f);
+    template <class _R1, class _Fp>
+        friend future<_R1> __make_mpi_staged_assoc_state(_Fp&& __f);
 
 public:
     _LIBCPP_INLINE_VISIBILITY
@@ -1305,6 +1804,9 @@ public:
     _LIBCPP_INLINE_VISIBILITY
     bool valid() const _NOEXCEPT {return __state_ != nullptr;}
 
+    _LIBCPP_INLINE_VISIBILITY
+    bool is_ready() const {return __state_->is_ready();}
+
     _LIBCPP_INLINE_VISIBILITY
     void wait() const {__state_->wait();}
     template <class _Rep, class _Period>
@@ -1370,6 +1872,10 @@ class _LIBCPP_TYPE_VIS future<void>
 
     template <class _R1, class _Fp>
         friend future<_R1> __make_mpi_assoc_state(_Fp&& __f);
+    template <class _R1, class _Fp>
+        friend future<_R1> __make_mpi_staged_assoc_state(_Fp&& __f);
+    template <class _Fp>
+        friend future<void> __make_mpi_pending_assoc_state(_Fp&& __f);
 
 public:
     _LIBCPP_INLINE_VISIBILITY
@@ -1406,6 +1912,9 @@ public:
     _LIBCPP_INLINE_VISIBILITY
     bool valid() const _NOEXCEPT {return __state_ != nullptr;}
 
+    _LIBCPP_INLINE_VISIBILITY
+    bool is_ready() const {return __state_->is_ready();}
+
     _LIBCPP_INLINE_VISIBILITY
     void wait() const {__state_->wait();}
     template <class _Rep, class _Period>
@@ -2258,6 +2767,36 @@ __make_mpi_assoc_state(_Fp&& __f)
     return future<_Rp>(__h.get());
 }
 
+template <class _Rp, class _Fp>
+future<_Rp>
+__make_mpi_staged_assoc_state(_Fp&& __f)
+{
+    unique_ptr<__mpi_staged_assoc_state<_Rp, _Fp>, __release_shared_count>
+        __h(new __mpi_staged_assoc_state<_Rp, _Fp>(std::forward<_Fp>(__f)));
+    __h.get()->__execute();
+    return future<_Rp>(__h.get());
+}
+
+template <class _Fp>
+future<void>
+__make_mpi_pending_assoc_state(_Fp&& __f)
+{
+    unique_ptr<__mpi_pending_assoc_state<_Fp>, __release_shared_count>
+        __h(new __mpi_pending_assoc_state<_Fp>(std::forward<_Fp>(__f)));
+    return future<void>(__h.get());
+}
+
+template <class _Rp, class _Fp>
+future<_Rp>
+__make_mpi_pending_value_assoc_state(_Fp&& __f)
+{
+    unique_ptr<__mpi_pending_value_assoc_state<_Rp, _Fp>,
+               __release_shared_count>
+        __h(new __mpi_pending_value_assoc_state<_Rp, _Fp>(
+                std::forward<_Fp>(__f)));
+    return future<_Rp>(__h.get());
+}
+
 template <class _Fp, class... _Args>
 class __async_func
 {
@@ -2282,7 +2821,7 @@ private:
     decltype(auto)
     __execute(__tuple_indices<_Indices...>, _ExArgs&&... __exargs)
     {
-        return __invoke(std::move(std::get<0>(__f_)),
+        return mpiex::__invoke(std::move(std::get<0>(__f_)),
             std::forward<_ExArgs>(__exargs)...,
             std::move(std::get<_Indices>(__f_))...);
     }
@@ -2391,6 +2930,9 @@ public:
     _LIBCPP_INLINE_VISIBILITY
     bool valid() const _NOEXCEPT {return __state_ != nullptr;}
 
+    _LIBCPP_INLINE_VISIBILITY
+    bool is_ready() const {return __state_->is_ready();}
+
     _LIBCPP_INLINE_VISIBILITY
     void wait() const {__state_->wait();}
     template <class _Rep, class _Period>
@@ -2465,6 +3007,9 @@ public:
     _LIBCPP_INLINE_VISIBILITY
     bool valid() const _NOEXCEPT {return __state_ != nullptr;}
 
+    _LIBCPP_INLINE_VISIBILITY
+    bool is_ready() const {return __state_->is_ready();}
+
     _LIBCPP_INLINE_VISIBILITY
     void wait() const {__state_->wait();}
     template <class _Rep, class _Period>
@@ -2539,6 +3084,9 @@ public:
     _LIBCPP_INLINE_VISIBILITY
     bool valid() const _NOEXCEPT {return __state_ != nullptr;}
 
+    _LIBCPP_INLINE_VISIBILITY
+    bool is_ready() const {return __state_->is_ready();}
+
     _LIBCPP_INLINE_VISIBILITY
     void wait() const {__state_->wait();}
     template <class _Rep, class _Period>
@@ -0,0 +1,71 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "future.h"
+#include "traits.h"
+#include "topology.h"
+
+#include <vector>
+
+namespace mpiex
+{
+
+// The ghost cells of a row-major array over a Cartesian grid, refreshed
+// by persistent requests on a private duplicate of the grid, one per
+// neighbor, each over a subarray datatype.
+struct halo_exchange
+{
+	// collective; extents are the interior of each dimension
+	template <typename T>
+	halo_exchange(topo_communicator const& comm, T* p,
+	    std::vector<int> const& extents, int ghost, bool corners = true)
+	{
+		init(comm, mpi_type_of<T>{}, p, extents, ghost, corners);
+	}
+
+	halo_exchange(halo_exchange const&) = delete;
+	halo_exchange& operator=(halo_exchange const&) = delete;
+
+	// waits for the exchange in progress, if any
+	~halo_exchange();
+
+	void start();
+	future<void> finish();
+
+	// messages per exchange, in each direction
+	size_t size() const;
+
+private:
+	void init(topo_communicator const& comm, MPI_Datatype dt, void* p,
+	    std::vector<int> const& extents, int ghost, bool corners);
+
+	MPI_Comm comm_;
+	std::vector<MPI_Datatype> types_;
+	std::vector<MPI_Request> reqs_;
+};
+
+}
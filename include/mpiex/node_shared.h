@@ -0,0 +1,131 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "future.h"
+#include "communicator.h"
+
+#include <vector>
+
+namespace mpiex
+{
+
+// An array in the shared memory of a node, of one segment per process
+// on the node, all of which every process on the node can load from and
+// store to directly.  The processes are in a passive-target epoch of the
+// window all the time, and synchronize with fence().
+template <typename T>
+struct node_shared_array
+{
+	// collective; sz elements in the segment of this process
+	node_shared_array(communicator comm, size_t sz) :
+		node_(comm.split_type())
+	{
+		T* p;
+		MPI_Win_allocate_shared(MPI_Aint(sz * sizeof(T)),
+		    int(sizeof(T)), MPI_INFO_NULL, node_.get(), &p, &win_);
+		MPI_Win_lock_all(MPI_MODE_NOCHECK, win_);
+
+		for (int i = 0; i < node_.size(); ++i)
+		{
+			MPI_Aint bytes;
+			int unit;
+			MPI_Win_shared_query(win_, i, &bytes, &unit, &p);
+			segs_.push_back(p);
+			sizes_.push_back(size_t(bytes) / sizeof(T));
+		}
+	}
+
+	node_shared_array(node_shared_array const&) = delete;
+	node_shared_array& operator=(node_shared_array const&) = delete;
+
+	// collective on the node
+	~node_shared_array()
+	{
+		MPI_Win_unlock_all(win_);
+		MPI_Win_free(&win_);
+	}
+
+	// the processes on the node
+	shared_communicator const& node() const
+	{
+		return node_;
+	}
+
+	T* data() const
+	{
+		return segs_[size_t(node_.rank())];
+	}
+
+	size_t size() const
+	{
+		return sizes_[size_t(node_.rank())];
+	}
+
+	// of the process with the rank i in node()
+	T* segment(int i) const
+	{
+		return segs_[size_t(i)];
+	}
+
+	size_t segment_size(int i) const
+	{
+		return sizes_[size_t(i)];
+	}
+
+	// Collective on the node.  The stores of every process before the
+	// fence are visible to the loads of all after it.
+	future<void> fence()
+	{
+		auto w = win_;
+		auto c = node_.get();
+		return __make_mpi_staged_assoc_state<void>(
+		    [=, stage = 0](std::vector<MPI_Request>& reqs) mutable
+		    {
+			MPI_Win_sync(w);
+			if (stage++ != 0)
+				return false;
+
+			MPI_Request r;
+			MPI_Ibarrier(c, &r);
+			reqs.push_back(r);
+			return true;
+		    });
+	}
+
+	MPI_Win get() const
+	{
+		return win_;
+	}
+
+private:
+	shared_communicator node_;
+	MPI_Win win_;
+	std::vector<T*> segs_;
+	std::vector<size_t> sizes_;
+};
+
+}
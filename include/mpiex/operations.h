@@ -23,13 +23,43 @@
  * SUCH DAMAGE.
  */
 
+#pragma once
+
 #include "future.h"
 #include "traits.h"
 #include "communicator.h"
+#include "completion_queue.h"
+#include "algorithms.h"
+#include "__coll.h"
+
+#include <algorithm>
+#include <vector>
 
 namespace mpiex
 {
 
+template <typename T>
+struct gathered
+{
+    std::vector<T> data;
+    std::vector<int> counts;
+    std::vector<int> displs;
+};
+
+inline
+std::vector<int>
+__displs_of(std::vector<int> const& counts)
+{
+    std::vector<int> displs(counts.size());
+    int n = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        displs[i] = n;
+        n += counts[i];
+    }
+    return displs;
+}
+
 template <typename T>
 inline
 future<void>
@@ -72,6 +102,46 @@ recv(communicator comm, int src, T& v, int tag = 0)
     return recv(comm, src, std::addressof(v), 1, tag);
 }
 
+template <typename T>
+inline
+void
+send(completion_queue& cq, std::uint64_t id, communicator comm, int dest,
+    T const* p, size_t sz, int tag = 0)
+{
+    MPI_Request r;
+    MPI_Isend(p, int(sz), mpi_type_of<T>{}, dest, tag, comm.get(), &r);
+    cq.post(id, r);
+}
+
+template <typename T>
+inline
+void
+recv(completion_queue& cq, std::uint64_t id, communicator comm, int src,
+    T* p, size_t sz, int tag = 0)
+{
+    MPI_Request r;
+    MPI_Irecv(p, int(sz), mpi_type_of<T>{}, src, tag, comm.get(), &r);
+    cq.post(id, r);
+}
+
+template <typename T>
+inline
+void
+send(completion_queue& cq, std::uint64_t id, communicator comm, int dest,
+    T const& v, int tag = 0)
+{
+    send(cq, id, comm, dest, std::addressof(v), 1, tag);
+}
+
+template <typename T>
+inline
+void
+recv(completion_queue& cq, std::uint64_t id, communicator comm, int src,
+    T& v, int tag = 0)
+{
+    recv(cq, id, comm, src, std::addressof(v), 1, tag);
+}
+
 template <typename T>
 inline
 auto
@@ -85,6 +155,40 @@ receive(communicator comm, int src, int tag = 0)
         });
 }
 
+inline
+future<void>
+barrier(communicator comm)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Ibarrier(comm.get(), &r);
+            return r;
+        });
+}
+
+inline
+future<shared_communicator>
+idup(communicator comm)
+{
+    // the new handle is valid once the request completes
+    return __make_mpi_staged_assoc_state<shared_communicator>(
+        [=, c = std::make_shared<MPI_Comm>(MPI_COMM_NULL), stage = 0](
+            shared_communicator& v, std::vector<MPI_Request>& reqs) mutable
+        {
+            if (stage++ == 0)
+            {
+                MPI_Request r;
+                MPI_Comm_idup(comm.get(), c.get(), &r);
+                reqs.push_back(r);
+                return true;
+            }
+
+            v = shared_communicator(*c);
+            return false;
+        });
+}
+
 template <typename T, typename F>
 inline
 auto
@@ -99,4 +203,679 @@ reduce(communicator comm, int dest, T const& x, F)
         });
 }
 
+template <typename T, typename F>
+inline
+future<void>
+reduce(communicator comm, int dest, T const* p, T* q, size_t sz, F)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Ireduce(p, q, int(sz), mpi_type_of<T>{}, mpi_op_of<F>{}, dest,
+                comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T, typename F>
+inline
+future<void>
+allreduce(communicator comm, T const* p, T* q, size_t sz, F)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Iallreduce(p, q, int(sz), mpi_type_of<T>{}, mpi_op_of<F>{},
+                comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T, typename F>
+inline
+auto
+allreduce(communicator comm, T const& x, F)
+{
+    return mpi_async<T>([=](T& y)
+        {
+            MPI_Request r;
+            MPI_Iallreduce(std::addressof(x), std::addressof(y), 1,
+                mpi_type_of<T>{}, mpi_op_of<F>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T, typename F>
+inline
+future<void>
+reduce_scatter_block(communicator comm, T const* p, T* q, size_t sz, F)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Ireduce_scatter_block(p, q, int(sz), mpi_type_of<T>{},
+                mpi_op_of<F>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T, typename F>
+inline
+future<void>
+reduce_scatter(communicator comm, T const* p, T* q, int const* counts, F)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Ireduce_scatter(p, q, counts, mpi_type_of<T>{},
+                mpi_op_of<F>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+// Prefix reduction by recursive doubling on the private channel, for the
+// operators without an MPI_Op.  After the round of distance d, partial
+// holds the reduction of the inputs of the d ranks ending at this one;
+// what comes from below is always the left operand.
+template <typename T, typename F>
+struct __scan_step
+{
+    __coll_channel ch;
+    std::vector<T> partial;
+    T* q;
+    F f;
+    bool exclusive;
+    int dist;
+    std::vector<T> in;
+
+    bool operator()(T& y, std::vector<MPI_Request>& reqs)
+    {
+        q = std::addressof(y);
+        return (*this)(reqs);
+    }
+
+    bool operator()(std::vector<MPI_Request>& reqs)
+    {
+        auto r = ch.rank;
+        auto sz = partial.size();
+
+        if (dist == 0)
+        {
+            if (!exclusive)
+                std::copy(partial.begin(), partial.end(), q);
+            in.resize(sz);
+            dist = 1;
+        }
+        else
+        {
+            if (r >= dist)
+            {
+                // an exclusive scan takes the first contribution as is
+                bool first = exclusive && dist == 1;
+                for (size_t i = 0; i < sz; ++i)
+                {
+                    q[i] = first ? in[i] : f(in[i], q[i]);
+                    partial[i] = f(in[i], partial[i]);
+                }
+            }
+            dist <<= 1;
+        }
+
+        if (dist >= ch.size)
+            return false;
+
+        MPI_Request req;
+        if (r + dist < ch.size)
+        {
+            MPI_Isend(partial.data(), int(sz), mpi_type_of<T>{}, r + dist,
+                ch.tag, ch.comm, &req);
+            reqs.push_back(req);
+        }
+        if (r >= dist)
+        {
+            MPI_Irecv(in.data(), int(sz), mpi_type_of<T>{}, r - dist, ch.tag,
+                ch.comm, &req);
+            reqs.push_back(req);
+        }
+        return true;
+    }
+};
+
+template <typename T, typename F>
+inline
+future<void>
+__scan(std::true_type, communicator comm, T const* p, T* q, size_t sz, F,
+    bool exclusive)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            if (exclusive)
+                MPI_Iexscan(p, q, int(sz), mpi_type_of<T>{},
+                    mpi_op_of<F>{}, comm.get(), &r);
+            else
+                MPI_Iscan(p, q, int(sz), mpi_type_of<T>{}, mpi_op_of<F>{},
+                    comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T, typename F>
+inline
+future<void>
+__scan(std::false_type, communicator comm, T const* p, T* q, size_t sz, F f,
+    bool exclusive)
+{
+    return __make_mpi_staged_assoc_state<void>(__scan_step<T, F>{
+        __coll_begin(comm), std::vector<T>(p, p + sz), q, f, exclusive, 0 });
+}
+
+template <typename T, typename F>
+inline
+auto
+__scan(std::true_type, communicator comm, T const& x, F, bool exclusive)
+{
+    return mpi_async<T>([=](T& y)
+        {
+            MPI_Request r;
+            if (exclusive)
+                MPI_Iexscan(std::addressof(x), std::addressof(y), 1,
+                    mpi_type_of<T>{}, mpi_op_of<F>{}, comm.get(), &r);
+            else
+                MPI_Iscan(std::addressof(x), std::addressof(y), 1,
+                    mpi_type_of<T>{}, mpi_op_of<F>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T, typename F>
+inline
+auto
+__scan(std::false_type, communicator comm, T const& x, F f, bool exclusive)
+{
+    return __make_mpi_staged_assoc_state<T>(__scan_step<T, F>{
+        __coll_begin(comm), std::vector<T>(1, x), nullptr, f, exclusive,
+        0 });
+}
+
+template <typename T, typename F>
+inline
+future<void>
+scan(communicator comm, T const* p, T* q, size_t sz, F f)
+{
+    return __scan(__has_mpi_op<F>(), comm, p, q, sz, f, false);
+}
+
+template <typename T, typename F>
+inline
+auto
+scan(communicator comm, T const& x, F f)
+{
+    return __scan(__has_mpi_op<F>(), comm, x, f, false);
+}
+
+template <typename T, typename F>
+inline
+future<void>
+exscan(communicator comm, T const* p, T* q, size_t sz, F f)
+{
+    return __scan(__has_mpi_op<F>(), comm, p, q, sz, f, true);
+}
+
+template <typename T, typename F>
+inline
+auto
+exscan(communicator comm, T const& x, F f)
+{
+    return __scan(__has_mpi_op<F>(), comm, x, f, true);
+}
+
+template <typename T>
+inline
+future<void>
+gather(communicator comm, int root, T const* p, T* q, size_t sz)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Igather(p, int(sz), mpi_type_of<T>{}, q, int(sz),
+                mpi_type_of<T>{}, root, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+auto
+gather(communicator comm, int root, T const& x)
+{
+    return mpi_async<std::vector<T>>([=](std::vector<T>& v)
+        {
+            if (comm.rank() == root)
+                v.resize(comm.size());
+
+            MPI_Request r;
+            MPI_Igather(std::addressof(x), 1, mpi_type_of<T>{}, v.data(), 1,
+                mpi_type_of<T>{}, root, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+future<void>
+scatter(communicator comm, int root, T const* p, T* q, size_t sz)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Iscatter(p, int(sz), mpi_type_of<T>{}, q, int(sz),
+                mpi_type_of<T>{}, root, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+auto
+scatter(communicator comm, int root, T const* p)
+{
+    return mpi_async<T>([=](T& y)
+        {
+            MPI_Request r;
+            MPI_Iscatter(p, 1, mpi_type_of<T>{}, std::addressof(y), 1,
+                mpi_type_of<T>{}, root, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+future<void>
+allgather(communicator comm, T const* p, T* q, size_t sz)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Iallgather(p, int(sz), mpi_type_of<T>{}, q, int(sz),
+                mpi_type_of<T>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+auto
+allgather(communicator comm, T const& x)
+{
+    return mpi_async<std::vector<T>>([=](std::vector<T>& v)
+        {
+            v.resize(comm.size());
+
+            MPI_Request r;
+            MPI_Iallgather(std::addressof(x), 1, mpi_type_of<T>{}, v.data(), 1,
+                mpi_type_of<T>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+future<void>
+gatherv(communicator comm, int root, T const* p, size_t sz, T* q,
+    int const* counts, int const* displs)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Igatherv(p, int(sz), mpi_type_of<T>{}, q, counts, displs,
+                mpi_type_of<T>{}, root, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+auto
+gatherv(communicator comm, int root, T const* p, size_t sz)
+{
+    auto ch = __coll_begin(comm);
+
+    // the counts are gathered first, without blocking, to size the result
+    return __make_mpi_staged_assoc_state<gathered<T>>(
+        [=, n = int(sz), stage = 0](gathered<T>& g,
+            std::vector<MPI_Request>& reqs) mutable
+        {
+            MPI_Request r;
+            bool is_root = ch.rank == root;
+
+            if (stage++ == 0)
+            {
+                if (is_root)
+                    g.counts.resize(ch.size);
+
+                MPI_Igather(&n, 1, MPI_INT, g.counts.data(), 1, MPI_INT,
+                    root, comm.get(), &r);
+                reqs.push_back(r);
+                return true;
+            }
+
+            // a later stage starts whenever this rank gets to it, so a
+            // collective here could be reordered against the others
+            if (!is_root)
+            {
+                MPI_Isend(p, n, mpi_type_of<T>{}, root, ch.tag, ch.comm,
+                    &r);
+                reqs.push_back(r);
+                return false;
+            }
+
+            g.displs = __displs_of(g.counts);
+            g.data.resize(g.displs.back() + g.counts.back());
+            std::copy_n(p, n, g.data.data() + g.displs[root]);
+
+            for (int i = 0; i < ch.size; ++i)
+            {
+                if (i == root)
+                    continue;
+
+                MPI_Irecv(g.data.data() + g.displs[i], g.counts[i],
+                    mpi_type_of<T>{}, i, ch.tag, ch.comm, &r);
+                reqs.push_back(r);
+            }
+            return false;
+        });
+}
+
+template <typename T>
+inline
+future<void>
+scatterv(communicator comm, int root, T const* p, int const* counts,
+    int const* displs, T* q, size_t sz)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Iscatterv(p, counts, displs, mpi_type_of<T>{}, q, int(sz),
+                mpi_type_of<T>{}, root, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+auto
+scatterv(communicator comm, int root, T const* p, int const* counts)
+{
+    auto ch = __coll_begin(comm);
+    std::vector<int> cnts, displs;
+    if (ch.rank == root)
+    {
+        cnts.assign(counts, counts + ch.size);
+        displs = __displs_of(cnts);
+    }
+
+    // the counts are scattered first, without blocking, to size the result
+    return __make_mpi_staged_assoc_state<std::vector<T>>(
+        [=, n = 0, stage = 0](std::vector<T>& v,
+            std::vector<MPI_Request>& reqs) mutable
+        {
+            MPI_Request r;
+
+            if (stage++ == 0)
+            {
+                MPI_Iscatter(cnts.data(), 1, MPI_INT, &n, 1, MPI_INT, root,
+                    comm.get(), &r);
+                reqs.push_back(r);
+                return true;
+            }
+
+            v.resize(n);
+            if (ch.rank != root)
+            {
+                MPI_Irecv(v.data(), n, mpi_type_of<T>{}, root, ch.tag,
+                    ch.comm, &r);
+                reqs.push_back(r);
+                return false;
+            }
+
+            std::copy_n(p + displs[root], n, v.data());
+            for (int i = 0; i < ch.size; ++i)
+            {
+                if (i == root)
+                    continue;
+
+                MPI_Isend(p + displs[i], cnts[i], mpi_type_of<T>{}, i,
+                    ch.tag, ch.comm, &r);
+                reqs.push_back(r);
+            }
+            return false;
+        });
+}
+
+template <typename T>
+inline
+future<void>
+allgatherv(communicator comm, T const* p, size_t sz, T* q,
+    int const* counts, int const* displs)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Iallgatherv(p, int(sz), mpi_type_of<T>{}, q, counts, displs,
+                mpi_type_of<T>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+auto
+allgatherv(communicator comm, T const* p, size_t sz)
+{
+    auto ch = __coll_begin(comm);
+
+    return __make_mpi_staged_assoc_state<gathered<T>>(
+        [=, n = int(sz), stage = 0](gathered<T>& g,
+            std::vector<MPI_Request>& reqs) mutable
+        {
+            MPI_Request r;
+
+            if (stage++ == 0)
+            {
+                g.counts.resize(ch.size);
+                MPI_Iallgather(&n, 1, MPI_INT, g.counts.data(), 1, MPI_INT,
+                    comm.get(), &r);
+                reqs.push_back(r);
+                return true;
+            }
+
+            g.displs = __displs_of(g.counts);
+            g.data.resize(g.displs.back() + g.counts.back());
+            std::copy_n(p, n, g.data.data() + g.displs[ch.rank]);
+
+            for (int i = 0; i < ch.size; ++i)
+            {
+                if (i == ch.rank)
+                    continue;
+
+                MPI_Irecv(g.data.data() + g.displs[i], g.counts[i],
+                    mpi_type_of<T>{}, i, ch.tag, ch.comm, &r);
+                reqs.push_back(r);
+                MPI_Isend(p, n, mpi_type_of<T>{}, i, ch.tag, ch.comm, &r);
+                reqs.push_back(r);
+            }
+            return false;
+        });
+}
+
+template <typename T>
+inline
+future<void>
+alltoall(communicator comm, T const* p, T* q, size_t sz)
+{
+    // O(log P) messages instead of O(P) when latency dominates
+    if (sz * sizeof(T) <= tuning().alltoall_bruck_max)
+        return alltoall_bruck(comm, p, q, sz);
+
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Ialltoall(p, int(sz), mpi_type_of<T>{}, q, int(sz),
+                mpi_type_of<T>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+future<void>
+alltoallv(communicator comm, T const* p, int const* scounts,
+    int const* sdispls, T* q, int const* rcounts, int const* rdispls)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Ialltoallv(p, scounts, sdispls, mpi_type_of<T>{}, q, rcounts,
+                rdispls, mpi_type_of<T>{}, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+struct __alltoallv_step
+{
+    communicator comm;
+    __coll_channel ch;
+    gathered<T> src;
+    T const* p;
+    int stage;
+
+    bool operator()(gathered<T>& g, std::vector<MPI_Request>& reqs)
+    {
+        MPI_Request r;
+
+        if (stage++ == 0)
+        {
+            g.counts.resize(ch.size);
+            MPI_Ialltoall(src.counts.data(), 1, MPI_INT, g.counts.data(), 1,
+                MPI_INT, comm.get(), &r);
+            reqs.push_back(r);
+            return true;
+        }
+
+        // pairwise messages on the private channel; an MPI_Ialltoallv
+        // started at this point may be reordered against other collectives
+        auto sp = p ? p : src.data.data();
+        int self = ch.rank;
+
+        g.displs = __displs_of(g.counts);
+        g.data.resize(g.displs.back() + g.counts.back());
+        std::copy_n(sp + src.displs[self], src.counts[self],
+            g.data.data() + g.displs[self]);
+
+        for (int i = 0; i < ch.size; ++i)
+        {
+            if (i == self)
+                continue;
+
+            MPI_Irecv(g.data.data() + g.displs[i], g.counts[i],
+                mpi_type_of<T>{}, i, ch.tag, ch.comm, &r);
+            reqs.push_back(r);
+            MPI_Isend(sp + src.displs[i], src.counts[i], mpi_type_of<T>{}, i,
+                ch.tag, ch.comm, &r);
+            reqs.push_back(r);
+        }
+        return false;
+    }
+};
+
+template <typename T>
+inline
+auto
+alltoallv(communicator comm, T const* p, int const* counts)
+{
+    gathered<T> src;
+    src.counts.assign(counts, counts + comm.size());
+    src.displs = __displs_of(src.counts);
+
+    // the counts are exchanged first, without blocking, to size the result
+    return __make_mpi_staged_assoc_state<gathered<T>>(
+        __alltoallv_step<T>{ comm, __coll_begin(comm), std::move(src), p,
+            0 });
+}
+
+template <typename T>
+inline
+auto
+alltoallv(communicator comm, gathered<T> src)
+{
+    return __make_mpi_staged_assoc_state<gathered<T>>(
+        __alltoallv_step<T>{ comm, __coll_begin(comm), std::move(src),
+            nullptr, 0 });
+}
+
+template <typename T, typename F>
+inline
+gathered<T>
+bucket(communicator comm, std::vector<T> const& v, F dest)
+{
+    gathered<T> b;
+    std::vector<int> to(v.size());
+
+    b.counts.assign(comm.size(), 0);
+    for (size_t i = 0; i < v.size(); ++i)
+        ++b.counts[to[i] = dest(v[i])];
+
+    b.displs = __displs_of(b.counts);
+    b.data.resize(v.size());
+
+    auto pos = b.displs;
+    for (size_t i = 0; i < v.size(); ++i)
+        b.data[pos[to[i]]++] = v[i];
+
+    return b;
+}
+
+template <typename T>
+inline
+future<void>
+bcast(communicator comm, int root, T* p, size_t sz)
+{
+    return mpi_async([=]
+        {
+            MPI_Request r;
+            MPI_Ibcast(p, int(sz), mpi_type_of<T>{}, root, comm.get(), &r);
+            return r;
+        });
+}
+
+template <typename T>
+inline
+future<void>
+bcast(communicator comm, int root, T& v)
+{
+    return bcast(comm, root, std::addressof(v), 1);
+}
+
+template <typename T>
+inline
+std::vector<future<void>>
+bcast_pipelined(communicator comm, int root, T* p, size_t sz, size_t chunk)
+{
+    // a zero chunk means no splitting
+    if (chunk == 0)
+        chunk = std::max<size_t>(sz, 1);
+
+    std::vector<future<void>> v;
+    v.reserve((sz + chunk - 1) / chunk);
+
+    // all the chunks are in flight at once, so that the tree stages of
+    // consecutive chunks overlap
+    for (size_t i = 0; i < sz; i += chunk)
+        v.push_back(bcast(comm, root, p + i, std::min(chunk, sz - i)));
+
+    return v;
+}
+
 }
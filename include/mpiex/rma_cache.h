@@ -0,0 +1,190 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "window.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace mpiex
+{
+
+template <typename T>
+struct __cache_block
+{
+	std::vector<T> data;
+	shared_future<void> ready;
+};
+
+// A cache of the blocks of the remote parts of a window, read by
+// MPI_Rget, and evicted in LRU order.  The reads of a block in flight
+// share its fetch.  Nothing is kept consistent with the writes to the
+// window, until invalidate() drops everything.
+template <typename T>
+struct rma_cache
+{
+	// collective; block in elements, capacity in blocks
+	rma_cache(communicator comm, window<T>& w, size_t block = 1024,
+	    size_t capacity = 256) :
+		win_(w), block_(block), capacity_(capacity),
+		sizes_(size_t(comm.size()))
+	{
+		uint64_t mine = w.size();
+		MPI_Allgather(&mine, 1, MPI_UINT64_T, sizes_.data(), 1,
+		    MPI_UINT64_T, comm.get());
+	}
+
+	rma_cache(rma_cache const&) = delete;
+	rma_cache& operator=(rma_cache const&) = delete;
+
+	// the elements disp through disp + sz - 1 of target
+	future<void> get(int target, size_t disp, T* p, size_t sz)
+	{
+		std::vector<std::shared_ptr<__cache_block<T>>> v;
+		auto first = disp / block_;
+		auto last = sz ? (disp + sz - 1) / block_ + 1 : first;
+		for (auto b = first; b < last; ++b)
+			v.push_back(__lookup(target, b));
+
+		auto bs = block_;
+		return __make_mpi_pending_assoc_state(
+		    [=, v = std::move(v), done = false](bool start) mutable
+		    {
+			if (done)
+				return true;
+
+			for (auto& blk : v)
+			{
+				if (start)
+					blk->ready.wait();
+				else if (!blk->ready.is_ready())
+					return false;
+			}
+
+			// the blocks stay alive even if evicted
+			for (size_t i = 0; i < v.size(); ++i)
+			{
+				auto lo = std::max(disp, (first + i) * bs);
+				auto hi = std::min(disp + sz,
+				    (first + i + 1) * bs);
+				std::copy(v[i]->data.data() +
+				    (lo - (first + i) * bs),
+				    v[i]->data.data() + (hi - (first + i) * bs),
+				    p + (lo - disp));
+			}
+			done = true;
+			return true;
+		    });
+	}
+
+	// the epoch boundary; the reads in flight complete as started
+	void invalidate()
+	{
+		lru_.clear();
+		map_.clear();
+	}
+
+	// blocks cached
+	size_t size() const
+	{
+		return map_.size();
+	}
+
+	size_t hits() const
+	{
+		return hits_;
+	}
+
+	// blocks fetched
+	size_t misses() const
+	{
+		return misses_;
+	}
+
+private:
+	using __key = std::pair<int, size_t>;
+
+	struct __key_hash
+	{
+		size_t operator()(__key const& k) const
+		{
+			return std::hash<size_t>()(k.second * 31 +
+			    size_t(k.first));
+		}
+	};
+
+	struct __entry
+	{
+		std::shared_ptr<__cache_block<T>> blk;
+		typename std::list<__key>::iterator pos;
+	};
+
+	std::shared_ptr<__cache_block<T>> __lookup(int target, size_t b)
+	{
+		__key k{ target, b };
+		auto it = map_.find(k);
+		if (it != map_.end())
+		{
+			++hits_;
+			lru_.splice(lru_.begin(), lru_, it->second.pos);
+			return it->second.blk;
+		}
+
+		++misses_;
+		auto blk = std::make_shared<__cache_block<T>>();
+		auto start = b * block_;
+		auto end = std::min<size_t>(start + block_,
+		    size_t(sizes_[size_t(target)]));
+		blk->data.resize(end > start ? end - start : 0);
+		blk->ready = win_.get(target, start, blk->data.data(),
+		    blk->data.size()).share();
+
+		lru_.push_front(k);
+		map_.emplace(k, __entry{ blk, lru_.begin() });
+		if (map_.size() > capacity_)
+		{
+			map_.erase(lru_.back());
+			lru_.pop_back();
+		}
+		return blk;
+	}
+
+	window<T>& win_;
+	size_t block_;
+	size_t capacity_;
+	std::vector<uint64_t> sizes_;
+	std::list<__key> lru_;	// the most recent first
+	std::unordered_map<__key, __entry, __key_hash> map_;
+	size_t hits_ = 0;
+	size_t misses_ = 0;
+};
+
+}
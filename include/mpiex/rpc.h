@@ -0,0 +1,321 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "future.h"
+#include "traits.h"
+#include "communicator.h"
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mpiex
+{
+
+template <typename T>
+inline
+void
+__rpc_pack(T const& v, std::vector<char>& buf, MPI_Comm comm)
+{
+	int sz;
+	MPI_Pack_size(1, mpi_type_of<T>{}, comm, &sz);
+	int pos = int(buf.size());
+	buf.resize(buf.size() + size_t(sz));
+	MPI_Pack(&v, 1, mpi_type_of<T>{}, buf.data(), int(buf.size()), &pos,
+	    comm);
+	buf.resize(size_t(pos));
+}
+
+template <typename T>
+inline
+T
+__rpc_unpack(char const* p, int n, int& pos, MPI_Comm comm)
+{
+	T v;
+	MPI_Unpack(p, n, &pos, &v, 1, mpi_type_of<T>{}, comm);
+	return v;
+}
+
+// The state shared by the copies of an rpc_communicator.  The calls to a
+// rank are packed into its batch, which is sent as a single message once
+// it outgrows the budget, or when it is flushed.  Each batch received is
+// answered with a single message of the results, in the same order.
+struct __rpc_engine : __mpi_progress_node
+{
+	// unpacks the arguments at pos, and packs the result
+	using handler = std::function<void(char const*, int, int&,
+	    std::vector<char>&)>;
+	// unpacks the result at pos, unless given the error of the handler
+	using reply = std::function<void(char const*, int, int&,
+	    std::exception_ptr)>;
+
+	__rpc_engine(communicator comm, size_t batch);
+	~__rpc_engine();
+
+	int add(handler h);
+
+	// packs the header of a call into the batch for dest, and returns the
+	// batch to pack the arguments into; then end_call(dest)
+	std::vector<char>& begin_call(int dest, int id, reply r);
+	void end_call(int dest);
+
+	void flush(int dest);
+	void progress(bool flush);
+	virtual void __poll() override;
+
+	std::recursive_mutex mut;
+	shared_communicator comm;
+
+private:
+	struct batch
+	{
+		int source;
+		std::vector<char> data;
+		int pos;
+		std::vector<char> out;
+	};
+
+	struct send
+	{
+		std::vector<char> data;
+		MPI_Request req;
+	};
+
+	void post(int dest, int tag, std::vector<char> data);
+	bool serve(batch& b);
+	void complete(std::vector<char> const& data);
+
+	size_t batch_;
+	std::deque<handler> handlers_;
+	std::vector<std::vector<char>> out_;
+	std::vector<send> sends_;
+	std::deque<batch> in_;
+	std::unordered_map<int, reply> pending_;
+	int seq_;
+	bool serving_;
+};
+
+template <typename Sig>
+struct rpc_handler;
+
+// The index of a handler in the registry of an rpc_communicator.
+template <typename R, typename... Args>
+struct rpc_handler<R(Args...)>
+{
+	int id;
+};
+
+template <typename F, typename Tuple, size_t... I>
+inline
+void
+__rpc_invoke(F& f, Tuple& args, std::vector<char>&, MPI_Comm,
+    std::index_sequence<I...>, std::true_type)
+{
+	f(std::move(std::get<I>(args))...);
+}
+
+template <typename F, typename Tuple, size_t... I>
+inline
+void
+__rpc_invoke(F& f, Tuple& args, std::vector<char>& out, MPI_Comm comm,
+    std::index_sequence<I...>, std::false_type)
+{
+	using R = std::decay_t<decltype(f(std::move(std::get<I>(args))...))>;
+	__rpc_pack<R>(f(std::move(std::get<I>(args))...), out, comm);
+}
+
+template <typename R, typename... Args, typename F>
+inline
+__rpc_engine::handler
+__rpc_make_handler(F f, MPI_Comm comm)
+{
+	return [=](char const* p, int n, int& pos,
+	    std::vector<char>& out) mutable
+	    {
+		// a braced list is evaluated from left to right
+		std::tuple<std::decay_t<Args>...> args{
+		    __rpc_unpack<std::decay_t<Args>>(p, n, pos, comm)... };
+		__rpc_invoke(f, args, out, comm,
+		    std::index_sequence_for<Args...>(), std::is_void<R>());
+	    };
+}
+
+template <typename R>
+struct __rpc_slot
+{
+	bool done = false;
+	std::exception_ptr error;
+	R value;
+
+	void set(char const* p, int n, int& pos, MPI_Comm comm)
+	{
+		value = __rpc_unpack<R>(p, n, pos, comm);
+	}
+};
+
+template <>
+struct __rpc_slot<void>
+{
+	bool done = false;
+	std::exception_ptr error;
+
+	void set(char const*, int, int&, MPI_Comm)
+	{}
+};
+
+template <typename R>
+inline
+future<R>
+__rpc_future(std::shared_ptr<__rpc_engine> e, int dest,
+    std::shared_ptr<__rpc_slot<R>> s)
+{
+	return __make_mpi_pending_value_assoc_state<R>(
+	    [=](bool start, R& v)
+	    {
+		if (start)
+		{
+			e->flush(dest);
+			return false;
+		}
+
+		e->progress(false);
+		std::lock_guard<std::recursive_mutex> lk(e->mut);
+		if (!s->done)
+			return false;
+		if (s->error)
+			std::rethrow_exception(s->error);
+		v = std::move(s->value);
+		return true;
+	    });
+}
+
+inline
+future<void>
+__rpc_future(std::shared_ptr<__rpc_engine> e, int dest,
+    std::shared_ptr<__rpc_slot<void>> s)
+{
+	return __make_mpi_pending_assoc_state(
+	    [=](bool start)
+	    {
+		if (start)
+		{
+			e->flush(dest);
+			return false;
+		}
+
+		e->progress(false);
+		std::lock_guard<std::recursive_mutex> lk(e->mut);
+		if (!s->done)
+			return false;
+		if (s->error)
+			std::rethrow_exception(s->error);
+		return true;
+	    });
+}
+
+// A communicator whose processes run the handlers registered with it on
+// behalf of each other.  The calls received are served whenever the
+// process polls, or blocks on any MPI future.  The copies share the
+// registry and the calls in progress.
+struct rpc_communicator : communicator
+{
+	// collective; batch is the budget of a batch in bytes
+	explicit rpc_communicator(communicator comm, size_t batch = 4096);
+
+	// in the same order on all processes
+	template <typename Sig, typename F>
+	rpc_handler<Sig> add(F f)
+	{
+		return add(static_cast<rpc_handler<Sig>*>(nullptr), std::move(f));
+	}
+
+	template <typename R, typename... Args>
+	rpc_handler<R(Args...)> add(R (*f)(Args...))
+	{
+		return add<R(Args...)>(f);
+	}
+
+	// sends the batches, and serves the calls received
+	void poll()
+	{
+		e_->progress(true);
+	}
+
+private:
+	template <typename R, typename... Args, typename F>
+	rpc_handler<R(Args...)> add(rpc_handler<R(Args...)>*, F f)
+	{
+		return { e_->add(__rpc_make_handler<R, Args...>(std::move(f),
+		    e_->comm.get())) };
+	}
+
+	template <typename R, typename... Args, typename... Ts>
+	friend future<R> remote_call(rpc_communicator const&, int,
+	    rpc_handler<R(Args...)>, Ts const&...);
+
+	std::shared_ptr<__rpc_engine> e_;
+};
+
+template <typename R, typename... Args, typename... Ts>
+inline
+future<R>
+remote_call(rpc_communicator const& comm, int rank, rpc_handler<R(Args...)> h,
+    Ts const&... args)
+{
+	static_assert(sizeof...(Ts) == sizeof...(Args),
+	    "wrong number of arguments");
+
+	auto e = comm.e_;
+	auto s = std::make_shared<__rpc_slot<R>>();
+	MPI_Comm c = e->comm.get();
+
+	std::lock_guard<std::recursive_mutex> lk(e->mut);
+	auto& buf = e->begin_call(rank, h.id,
+	    [s, c](char const* p, int n, int& pos, std::exception_ptr err)
+	    {
+		if (err)
+			s->error = err;
+		else
+			s->set(p, n, pos, c);
+		s->done = true;
+	    });
+	int expand[] = { 0,
+	    (__rpc_pack<std::decay_t<Args>>(args, buf, c), 0)... };
+	(void)expand;
+	e->end_call(rank);
+
+	return __rpc_future(e, rank, s);
+}
+
+}
@@ -0,0 +1,313 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "algorithms.h"
+
+#include <cstdint>
+
+namespace mpiex
+{
+
+// An array of size elements, of which those not listed are zeros.  If
+// dense, value holds all of them, and index is empty.
+template <typename T>
+struct sparse_array
+{
+	size_t size = 0;
+	bool dense = false;
+	std::vector<uint64_t> index;	// sorted, without duplicates
+	std::vector<T> value;
+};
+
+template <typename T>
+inline
+void
+__densify(sparse_array<T>& x)
+{
+	std::vector<T> v(x.size);
+	for (size_t k = 0; k < x.index.size(); ++k)
+		v[x.index[k]] = x.value[k];
+
+	x.value.swap(v);
+	x.index.clear();
+	x.dense = true;
+}
+
+// Recursive doubling as in __rd_allreduce_step, where each exchange sends
+// a header of the number of pairs and the representation first, since the
+// lengths are not known in advance.  A payload is sent only in the stage
+// where the peer posts its receive, as a stage completes only when its
+// sends do.  Both sides of an exchange end up with the same array, so that
+// they go dense at the same time.
+template <typename T, typename F>
+struct __sparse_allreduce_step
+{
+	__coll_channel ch;
+	sparse_array<T> cur;
+	F f;
+	int phase;
+	int pof2;
+	int rem;
+	int vr;
+	int dist;
+	int peer;
+	uint64_t shdr[2];
+	uint64_t rhdr[2];
+	sparse_array<T> in;
+
+	enum
+	{
+		start,
+		fold_send,
+		fold_payload,
+		fold_merge,
+		payload,
+		merge,
+		result_send,
+		result_payload,
+		result
+	};
+
+	bool operator()(sparse_array<T>& out, std::vector<MPI_Request>& reqs)
+	{
+		auto r = ch.rank;
+
+		switch (phase)
+		{
+		case start:
+			for (pof2 = 1; pof2 * 2 <= ch.size; pof2 *= 2)
+				;
+			rem = ch.size - pof2;
+
+			if (r < 2 * rem && r % 2 == 0)
+			{
+				send_header(reqs, r + 1);
+				phase = fold_send;
+				return true;
+			}
+			else if (r < 2 * rem)
+			{
+				recv_header(reqs, r - 1);
+				phase = fold_payload;
+				return true;
+			}
+
+			vr = r - rem;
+			dist = 1;
+			break;
+
+		case fold_send:
+			send_payload(reqs, r + 1);
+			recv_header(reqs, r + 1);
+			phase = result_payload;
+			return true;
+
+		case fold_payload:
+			recv_payload(reqs, r - 1);
+			phase = fold_merge;
+			return true;
+
+		case fold_merge:
+			combine();
+			vr = r / 2;
+			dist = 1;
+			break;
+
+		case payload:
+			send_payload(reqs, peer);
+			recv_payload(reqs, peer);
+			phase = merge;
+			return true;
+
+		case merge:
+			combine();
+			dist <<= 1;
+			break;
+
+		case result_send:
+			send_payload(reqs, r - 1);
+			out = cur;
+			return false;
+
+		case result_payload:
+			recv_payload(reqs, r + 1);
+			phase = result;
+			return true;
+
+		case result:
+			out = std::move(in);
+			return false;
+		}
+
+		if (dist < pof2)
+		{
+			int v = vr ^ dist;
+			peer = v < rem ? v * 2 + 1 : v + rem;
+			send_header(reqs, peer);
+			recv_header(reqs, peer);
+			phase = payload;
+			return true;
+		}
+
+		if (r < 2 * rem)
+		{
+			send_header(reqs, r - 1);
+			phase = result_send;
+			return true;
+		}
+		out = cur;
+		return false;
+	}
+
+	void send_header(std::vector<MPI_Request>& reqs, int to)
+	{
+		MPI_Request req;
+		shdr[0] = cur.value.size();
+		shdr[1] = cur.dense;
+		MPI_Isend(shdr, 2, MPI_UINT64_T, to, ch.tag, ch.comm, &req);
+		reqs.push_back(req);
+	}
+
+	// messages between two ranks with the same tag are not overtaking,
+	// so the payload follows the header
+	void send_payload(std::vector<MPI_Request>& reqs, int to)
+	{
+		MPI_Request req;
+		if (!cur.dense)
+		{
+			MPI_Isend(cur.index.data(), int(cur.index.size()),
+			    MPI_UINT64_T, to, ch.tag, ch.comm, &req);
+			reqs.push_back(req);
+		}
+		MPI_Isend(cur.value.data(), int(cur.value.size()),
+		    mpi_type_of<T>{}, to, ch.tag, ch.comm, &req);
+		reqs.push_back(req);
+	}
+
+	void recv_header(std::vector<MPI_Request>& reqs, int from)
+	{
+		MPI_Request req;
+		MPI_Irecv(rhdr, 2, MPI_UINT64_T, from, ch.tag, ch.comm, &req);
+		reqs.push_back(req);
+	}
+
+	void recv_payload(std::vector<MPI_Request>& reqs, int from)
+	{
+		MPI_Request req;
+		in.size = cur.size;
+		in.dense = rhdr[1] != 0;
+		in.index.resize(in.dense ? 0 : size_t(rhdr[0]));
+		in.value.resize(size_t(rhdr[0]));
+
+		if (!in.dense)
+		{
+			MPI_Irecv(in.index.data(), int(in.index.size()),
+			    MPI_UINT64_T, from, ch.tag, ch.comm, &req);
+			reqs.push_back(req);
+		}
+		MPI_Irecv(in.value.data(), int(in.value.size()),
+		    mpi_type_of<T>{}, from, ch.tag, ch.comm, &req);
+		reqs.push_back(req);
+	}
+
+	void combine()
+	{
+		if (cur.dense || in.dense)
+		{
+			if (!cur.dense)
+				std::swap(cur, in);
+			if (in.dense)
+				for (size_t i = 0; i < cur.size; ++i)
+					cur.value[i] = f(cur.value[i], in.value[i]);
+			else
+				for (size_t k = 0; k < in.index.size(); ++k)
+				{
+					auto& v = cur.value[in.index[k]];
+					v = f(v, in.value[k]);
+				}
+			return;
+		}
+
+		// sorted merge
+		sparse_array<T> m;
+		m.size = cur.size;
+		m.index.reserve(cur.index.size() + in.index.size());
+		m.value.reserve(m.index.capacity());
+
+		size_t i = 0, j = 0;
+		while (i < cur.index.size() && j < in.index.size())
+		{
+			if (cur.index[i] < in.index[j])
+			{
+				m.index.push_back(cur.index[i]);
+				m.value.push_back(cur.value[i++]);
+			}
+			else if (in.index[j] < cur.index[i])
+			{
+				m.index.push_back(in.index[j]);
+				m.value.push_back(in.value[j++]);
+			}
+			else
+			{
+				m.index.push_back(cur.index[i]);
+				m.value.push_back(f(cur.value[i++],
+				    in.value[j++]));
+			}
+		}
+		m.index.insert(m.index.end(), cur.index.begin() + i,
+		    cur.index.end());
+		m.value.insert(m.value.end(), cur.value.begin() + i,
+		    cur.value.end());
+		m.index.insert(m.index.end(), in.index.begin() + j,
+		    in.index.end());
+		m.value.insert(m.value.end(), in.value.begin() + j,
+		    in.value.end());
+		cur = std::move(m);
+
+		auto sparse_bytes = cur.index.size() * (sizeof(uint64_t) +
+		    sizeof(T));
+		if (sparse_bytes >= tuning().sparse_dense_ratio * double(cur.size *
+		    sizeof(T)))
+			__densify(cur);
+	}
+};
+
+template <typename T, typename F>
+inline
+auto
+sparse_allreduce(communicator comm, sparse_array<T> x, F f)
+{
+	if (!x.dense && x.index.size() * (sizeof(uint64_t) + sizeof(T)) >=
+	    tuning().sparse_dense_ratio * double(x.size * sizeof(T)))
+		__densify(x);
+
+	return __make_mpi_staged_assoc_state<sparse_array<T>>(
+	    __sparse_allreduce_step<T, F>{ __coll_begin(comm), std::move(x),
+	    f, 0 });
+}
+
+}
@@ -0,0 +1,107 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "future.h"
+#include "traits.h"
+#include "communicator.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace mpiex
+{
+
+struct __topology;
+
+// A communicator with a process topology attached.
+struct topo_communicator : shared_communicator
+{
+	// in the order of the blocks of the neighborhood collectives
+	std::vector<int> const& sources() const;
+	std::vector<int> const& destinations() const;
+
+	// empty unless Cartesian
+	std::vector<int> const& dims() const;
+	std::vector<bool> const& periods() const;
+	std::vector<int> const& coords() const;
+
+	// Cartesian only; MPI_PROC_NULL beyond a non-periodic boundary
+	std::pair<int, int> shift(int dim, int disp) const;
+	int rank_at(std::vector<int> coords) const;
+
+private:
+	topo_communicator(MPI_Comm comm, std::shared_ptr<__topology> t);
+
+	friend topo_communicator cart_create(communicator,
+	    std::vector<int>, std::vector<bool>, bool);
+	friend topo_communicator dist_graph_create_adjacent(communicator,
+	    std::vector<int> const&, std::vector<int> const&, bool);
+
+	std::shared_ptr<__topology> topo_;
+};
+
+// Collective.  The zeros in dims are filled by MPI_Dims_create.  The
+// processes left out of the grid get MPI_COMM_NULL.
+topo_communicator cart_create(communicator comm, std::vector<int> dims,
+    std::vector<bool> periods, bool reorder = true);
+
+// Collective.
+topo_communicator dist_graph_create_adjacent(communicator comm,
+    std::vector<int> const& sources, std::vector<int> const& destinations,
+    bool reorder = true);
+
+template <typename T>
+inline
+future<void>
+neighbor_allgather(communicator comm, T const* p, T* q, size_t sz)
+{
+	return mpi_async([=]
+	    {
+		MPI_Request r;
+		MPI_Ineighbor_allgather(p, int(sz), mpi_type_of<T>{}, q,
+		    int(sz), mpi_type_of<T>{}, comm.get(), &r);
+		return r;
+	    });
+}
+
+template <typename T>
+inline
+future<void>
+neighbor_alltoallv(communicator comm, T const* p, int const* scounts,
+    int const* sdispls, T* q, int const* rcounts, int const* rdispls)
+{
+	return mpi_async([=]
+	    {
+		MPI_Request r;
+		MPI_Ineighbor_alltoallv(p, scounts, sdispls, mpi_type_of<T>{},
+		    q, rcounts, rdispls, mpi_type_of<T>{}, comm.get(), &r);
+		return r;
+	    });
+}
+
+}
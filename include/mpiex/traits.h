@@ -108,4 +108,11 @@ struct mpi_op_of<std::bit_or<>> : mpi_op_c<MPI_BOR> {};
 template <>
 struct mpi_op_of<std::bit_xor<>> : mpi_op_c<MPI_BXOR> {};
 
+template <typename F, typename = void>
+struct __has_mpi_op : std::false_type {};
+
+template <typename F>
+struct __has_mpi_op<F, decltype(void(sizeof(mpi_op_of<F>)))>
+    : std::true_type {};
+
 }
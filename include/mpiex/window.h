@@ -0,0 +1,196 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "future.h"
+#include "traits.h"
+#include "communicator.h"
+
+namespace mpiex
+{
+
+// An RMA window of elements of T on every process of a communicator, in
+// a passive-target epoch for all of them from construction to destruction.
+// The displacements are in elements.
+template <typename T>
+struct window
+{
+	// collective; allocates sz elements on this process
+	window(communicator comm, size_t sz) : size_(sz)
+	{
+		MPI_Win_allocate(MPI_Aint(sz * sizeof(T)), int(sizeof(T)),
+		    MPI_INFO_NULL, comm.get(), &data_, &win_);
+		MPI_Win_lock_all(MPI_MODE_NOCHECK, win_);
+	}
+
+	// collective; exposes sz elements at p on this process
+	window(communicator comm, T* p, size_t sz) : data_(p), size_(sz)
+	{
+		MPI_Win_create(p, MPI_Aint(sz * sizeof(T)), int(sizeof(T)),
+		    MPI_INFO_NULL, comm.get(), &win_);
+		MPI_Win_lock_all(MPI_MODE_NOCHECK, win_);
+	}
+
+	window(window const&) = delete;
+	window& operator=(window const&) = delete;
+
+	// collective
+	~window()
+	{
+		MPI_Win_unlock_all(win_);
+		MPI_Win_free(&win_);
+	}
+
+	T* data() const
+	{
+		return data_;
+	}
+
+	size_t size() const
+	{
+		return size_;
+	}
+
+	MPI_Win get() const
+	{
+		return win_;
+	}
+
+	// ready once the buffer can be reused; the data reaches the target at
+	// the next flush
+	future<void> put(int target, size_t disp, T const* p, size_t sz)
+	{
+		auto w = win_;
+		return mpi_async([=]
+		    {
+			MPI_Request r;
+			MPI_Rput(p, int(sz), mpi_type_of<T>{}, target,
+			    MPI_Aint(disp), int(sz), mpi_type_of<T>{}, w, &r);
+			return r;
+		    });
+	}
+
+	future<void> put(int target, size_t disp, T const& v)
+	{
+		auto w = win_;
+		return mpi_async([=]
+		    {
+			MPI_Request r;
+			MPI_Rput(std::addressof(v), 1, mpi_type_of<T>{},
+			    target, MPI_Aint(disp), 1, mpi_type_of<T>{}, w,
+			    &r);
+			return r;
+		    });
+	}
+
+	future<void> get(int target, size_t disp, T* p, size_t sz)
+	{
+		auto w = win_;
+		return mpi_async([=]
+		    {
+			MPI_Request r;
+			MPI_Rget(p, int(sz), mpi_type_of<T>{}, target,
+			    MPI_Aint(disp), int(sz), mpi_type_of<T>{}, w, &r);
+			return r;
+		    });
+	}
+
+	future<T> get(int target, size_t disp)
+	{
+		auto w = win_;
+		return mpi_async<T>([=](T& v)
+		    {
+			MPI_Request r;
+			MPI_Rget(std::addressof(v), 1, mpi_type_of<T>{},
+			    target, MPI_Aint(disp), 1, mpi_type_of<T>{}, w,
+			    &r);
+			return r;
+		    });
+	}
+
+	// element-wise, atomic with respect to the other accumulations
+	template <typename F>
+	future<void> accumulate(int target, size_t disp, T const* p, size_t sz,
+	    F)
+	{
+		auto w = win_;
+		return mpi_async([=]
+		    {
+			MPI_Request r;
+			MPI_Raccumulate(p, int(sz), mpi_type_of<T>{}, target,
+			    MPI_Aint(disp), int(sz), mpi_type_of<T>{},
+			    mpi_op_of<F>{}, w, &r);
+			return r;
+		    });
+	}
+
+	// MPI has no non-blocking flush; it is performed by the first wait,
+	// or by the destructor of a future never waited on
+	future<void> flush(int target)
+	{
+		return __flush([target](MPI_Win w)
+		    {
+			MPI_Win_flush(target, w);
+		    });
+	}
+
+	future<void> flush_all()
+	{
+		return __flush([](MPI_Win w)
+		    {
+			MPI_Win_flush_all(w);
+		    });
+	}
+
+	// makes the updates by the others visible to the local loads
+	void sync()
+	{
+		MPI_Win_sync(win_);
+	}
+
+private:
+	template <typename F>
+	future<void> __flush(F f)
+	{
+		auto w = win_;
+		return __make_mpi_pending_assoc_state(
+		    [=, done = false](bool start) mutable
+		    {
+			if (start && !done)
+			{
+				f(w);
+				done = true;
+			}
+			return done;
+		    });
+	}
+
+	MPI_Win win_;
+	T* data_;
+	size_t size_;
+};
+
+}
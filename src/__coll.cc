@@ -0,0 +1,161 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <mpiex/__coll.h>
+
+#include <mutex>
+
+namespace mpiex
+{
+
+namespace
+{
+
+std::mutex mut;
+
+struct __coll_context
+{
+	MPI_Comm comm;
+	int rank;
+	int size;
+	int seq;
+};
+
+int
+__coll_context_delete(MPI_Comm, int, void* attr, void*)
+{
+	auto ctx = static_cast<__coll_context*>(attr);
+	MPI_Comm_free(&ctx->comm);
+	delete ctx;
+	return MPI_SUCCESS;
+}
+
+int
+__coll_keyval()
+{
+	static int keyval = []
+	    {
+		int k;
+		MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN,
+		    __coll_context_delete, &k, nullptr);
+		return k;
+	    }();
+	return keyval;
+}
+
+int
+__node_layout_delete(MPI_Comm, int, void* attr, void*)
+{
+	auto lo = static_cast<__node_layout*>(attr);
+	MPI_Comm_free(&lo->node);
+	if (lo->leaders != MPI_COMM_NULL)
+		MPI_Comm_free(&lo->leaders);
+	delete lo;
+	return MPI_SUCCESS;
+}
+
+int
+__node_keyval()
+{
+	static int keyval = []
+	    {
+		int k;
+		MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN,
+		    __node_layout_delete, &k, nullptr);
+		return k;
+	    }();
+	return keyval;
+}
+
+}
+
+__coll_channel
+__coll_begin(communicator comm)
+{
+	std::lock_guard<std::mutex> lk(mut);
+
+	__coll_context* ctx;
+	int found;
+	MPI_Comm_get_attr(comm.get(), __coll_keyval(), &ctx, &found);
+
+	if (!found)
+	{
+		ctx = new __coll_context{ MPI_COMM_NULL, 0, 0, 0 };
+		MPI_Comm_dup(comm.get(), &ctx->comm);
+		MPI_Comm_rank(ctx->comm, &ctx->rank);
+		MPI_Comm_size(ctx->comm, &ctx->size);
+		MPI_Comm_set_attr(comm.get(), __coll_keyval(), ctx);
+	}
+
+	// MPI guarantees at least 32767 as the upper bound of tags
+	int tag = ctx->seq;
+	ctx->seq = (ctx->seq + 1) % 32768;
+
+	return { ctx->comm, tag, ctx->rank, ctx->size };
+}
+
+__node_layout const&
+__node_begin(communicator comm)
+{
+	std::lock_guard<std::mutex> lk(mut);
+
+	__node_layout* lo;
+	int found;
+	MPI_Comm_get_attr(comm.get(), __node_keyval(), &lo, &found);
+
+	if (!found)
+	{
+		int rank, size;
+		MPI_Comm_rank(comm.get(), &rank);
+		MPI_Comm_size(comm.get(), &size);
+
+		lo = new __node_layout{ MPI_COMM_NULL, MPI_COMM_NULL, {}, {} };
+		MPI_Comm_split_type(comm.get(), MPI_COMM_TYPE_SHARED, rank,
+		    MPI_INFO_NULL, &lo->node);
+
+		int me[2] = { 0, 0 };
+		MPI_Comm_rank(lo->node, &me[1]);
+		MPI_Comm_split(comm.get(), me[1] == 0 ? 0 : MPI_UNDEFINED, rank,
+		    &lo->leaders);
+		if (lo->leaders != MPI_COMM_NULL)
+			MPI_Comm_rank(lo->leaders, &me[0]);
+		MPI_Bcast(&me[0], 1, MPI_INT, 0, lo->node);
+
+		std::vector<int> all(2 * size);
+		MPI_Allgather(me, 2, MPI_INT, all.data(), 2, MPI_INT,
+		    comm.get());
+		for (int i = 0; i < size; ++i)
+		{
+			lo->node_of.push_back(all[2 * i]);
+			lo->node_rank_of.push_back(all[2 * i + 1]);
+		}
+
+		MPI_Comm_set_attr(comm.get(), __node_keyval(), lo);
+	}
+
+	return *lo;
+}
+
+}
@@ -0,0 +1,177 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <mpiex/autotune.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace mpiex
+{
+
+namespace
+{
+
+char const* const op_names[] = { "reduce", "allreduce", "bcast" };
+
+char const* const algorithm_names[] = {
+	"native", "ring", "binomial", "recursive_doubling", "hierarchical"
+};
+
+// (op, size class) -> algorithm, the same on all the ranks of a
+// communicator since each entry is agreed on collectively
+typedef std::map<std::pair<int, int>, int> __choices;
+
+std::mutex mut;
+
+int
+__choices_delete(MPI_Comm, int, void* attr, void*)
+{
+	delete static_cast<__choices*>(attr);
+	return MPI_SUCCESS;
+}
+
+int
+__choices_keyval()
+{
+	static int keyval = []
+	    {
+		int k;
+		MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN,
+		    __choices_delete, &k, nullptr);
+		return k;
+	    }();
+	return keyval;
+}
+
+__choices&
+__choices_of(communicator comm)
+{
+	__choices* ch;
+	int found;
+	MPI_Comm_get_attr(comm.get(), __choices_keyval(), &ch, &found);
+
+	if (!found)
+	{
+		ch = new __choices;
+		MPI_Comm_set_attr(comm.get(), __choices_keyval(), ch);
+	}
+
+	return *ch;
+}
+
+int
+__size_class(size_t bytes)
+{
+	int n = 0;
+	for (; bytes != 0; bytes >>= 1)
+		++n;
+	return n;
+}
+
+// the last entry wins, so that the file may be appended to
+int
+__lookup_file(coll_op op, int cls, int size)
+{
+	std::ifstream in(tuning().autotune_file);
+	std::string o, a;
+	int c, n;
+	int found = -1;
+
+	while (in >> o >> c >> n >> a)
+	{
+		if (o != op_names[int(op)] || c != cls || n != size)
+			continue;
+
+		auto it = std::find(std::begin(algorithm_names),
+		    std::end(algorithm_names), a);
+		if (it != std::end(algorithm_names))
+			found = int(it - std::begin(algorithm_names));
+	}
+
+	return found;
+}
+
+}
+
+bool
+__tuned_find(communicator comm, coll_op op, size_t bytes, coll_algorithm& a)
+{
+	auto key = std::make_pair(int(op), __size_class(bytes));
+	int found = -1;
+
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		auto& ch = __choices_of(comm);
+		auto it = ch.find(key);
+
+		if (it != ch.end())
+		{
+			a = coll_algorithm(it->second);
+			return true;
+		}
+	}
+
+	// only rank 0 reads the file, so that all the ranks agree
+	if (comm.rank() == 0 && !tuning().autotune_file.empty())
+		found = __lookup_file(op, key.second, comm.size());
+	MPI_Bcast(&found, 1, MPI_INT, 0, comm.get());
+
+	if (found == -1)
+		return false;
+
+	std::lock_guard<std::mutex> lk(mut);
+	__choices_of(comm)[key] = found;
+	a = coll_algorithm(found);
+	return true;
+}
+
+coll_algorithm
+__tuned_pick(communicator comm, coll_op op, size_t bytes,
+    std::vector<coll_algorithm> const& cands, std::vector<double> times)
+{
+	MPI_Allreduce(MPI_IN_PLACE, times.data(), int(times.size()),
+	    MPI_DOUBLE, MPI_MAX, comm.get());
+
+	auto a = cands[std::min_element(times.begin(), times.end()) -
+	    times.begin()];
+	auto cls = __size_class(bytes);
+
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		__choices_of(comm)[std::make_pair(int(op), cls)] = int(a);
+	}
+
+	if (comm.rank() == 0 && !tuning().autotune_file.empty())
+		std::ofstream(tuning().autotune_file, std::ios::app)
+		    << op_names[int(op)] << ' ' << cls << ' ' << comm.size()
+		    << ' ' << algorithm_names[int(a)] << '\n';
+
+	return a;
+}
+
+}
@@ -0,0 +1,78 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <mpiex/communicator.h>
+
+namespace mpiex
+{
+
+__comm_owner::~__comm_owner()
+{
+	int done;
+	MPI_Finalized(&done);
+	if (done || comm == MPI_COMM_NULL || comm == MPI_COMM_WORLD ||
+	    comm == MPI_COMM_SELF)
+		return;
+
+	MPI_Comm_free(&comm);
+}
+
+shared_communicator::shared_communicator(MPI_Comm comm) :
+	communicator(comm), owner_(std::make_shared<__comm_owner>()),
+	rank_(MPI_UNDEFINED), size_(0)
+{
+	owner_->comm = comm;
+	if (comm == MPI_COMM_NULL)
+		return;
+
+	MPI_Comm_rank(comm, &rank_);
+	MPI_Comm_size(comm, &size_);
+}
+
+shared_communicator
+communicator::dup() const
+{
+	MPI_Comm c;
+	MPI_Comm_dup(get(), &c);
+	return shared_communicator(c);
+}
+
+shared_communicator
+communicator::split(int color, int key) const
+{
+	MPI_Comm c;
+	MPI_Comm_split(get(), color, key, &c);
+	return shared_communicator(c);
+}
+
+shared_communicator
+communicator::split_type(int type, int key) const
+{
+	MPI_Comm c;
+	MPI_Comm_split_type(get(), type, key, MPI_INFO_NULL, &c);
+	return shared_communicator(c);
+}
+
+}
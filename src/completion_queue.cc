@@ -0,0 +1,98 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <mpiex/completion_queue.h>
+
+#include <algorithm>
+
+namespace mpiex
+{
+
+completion_queue::~completion_queue()
+{
+	MPI_Waitall(int(reqs_.size()), reqs_.data(), MPI_STATUSES_IGNORE);
+}
+
+void
+completion_queue::post(std::uint64_t tag, MPI_Request r)
+{
+	if (r == MPI_REQUEST_NULL)
+	{
+		completion c = { tag, {} };
+		done_.push_back(c);
+		return;
+	}
+
+	reqs_.push_back(r);
+	tags_.push_back(tag);
+}
+
+size_t
+completion_queue::poll(completion* out, size_t max_n)
+{
+	// completions harvested by an earlier MPI_Testsome are delivered first;
+	// the MPI library has already released their requests
+	if (done_.size() < max_n && !reqs_.empty())
+	{
+		auto n = reqs_.size();
+		indices_.resize(n);
+		statuses_.resize(n);
+
+		int outcount;
+		MPI_Testsome(int(n), reqs_.data(), &outcount, indices_.data(),
+		    statuses_.data());
+
+		if (outcount != MPI_UNDEFINED && outcount > 0)
+		{
+			// a persistent request is not reset to MPI_REQUEST_NULL
+			// when it completes, so drop the completed ones by index
+			for (int i = 0; i < outcount; ++i)
+			{
+				done_.push_back({ tags_[indices_[i]],
+				    statuses_[i] });
+				reqs_[indices_[i]] = MPI_REQUEST_NULL;
+			}
+
+			size_t j = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				if (reqs_[i] == MPI_REQUEST_NULL)
+					continue;
+				reqs_[j] = reqs_[i];
+				tags_[j] = tags_[i];
+				++j;
+			}
+			reqs_.resize(j);
+			tags_.resize(j);
+		}
+	}
+
+	auto k = std::min(max_n, done_.size());
+	std::copy_n(done_.begin(), k, out);
+	done_.erase(done_.begin(), done_.begin() + k);
+	return k;
+}
+
+}
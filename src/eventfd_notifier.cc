@@ -0,0 +1,127 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#if defined(__linux__)
+
+#include <mpiex/eventfd_notifier.h>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <system_error>
+#include <cerrno>
+
+namespace mpiex
+{
+
+eventfd_notifier::eventfd_notifier(std::chrono::microseconds interval) :
+	fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+	interval_(interval)
+{
+	if (fd_ == -1)
+		throw std::system_error(errno, std::system_category(),
+		    "eventfd");
+
+	thr_ = thread(&eventfd_notifier::run, this);
+}
+
+eventfd_notifier::~eventfd_notifier()
+{
+	{
+		lock_guard<mutex> lk(mut_);
+		stop_ = true;
+	}
+	cv_.notify_one();
+	thr_.join();
+	::close(fd_);
+}
+
+void
+eventfd_notifier::watch(std::uint64_t tag, std::function<bool()> is_ready)
+{
+	std::list<entry> tmp;
+	tmp.push_back({ tag, std::move(is_ready) });
+
+	{
+		lock_guard<mutex> lk(mut_);
+		watched_.splice(watched_.end(), tmp);
+	}
+	cv_.notify_one();
+}
+
+std::vector<std::uint64_t>
+eventfd_notifier::poll()
+{
+	// reset the counter before collecting, so that a completion racing
+	// with this call leaves the descriptor readable rather than lost
+	std::uint64_t n;
+	(void)::read(fd_, &n, sizeof(n));
+
+	std::list<entry> tmp;
+	{
+		lock_guard<mutex> lk(mut_);
+		tmp.swap(fired_);
+	}
+
+	std::vector<std::uint64_t> v;
+	v.reserve(tmp.size());
+	for (auto& e : tmp)
+		v.push_back(e.tag);
+	return v;
+}
+
+void
+eventfd_notifier::run()
+{
+	unique_lock<mutex> lk(mut_);
+	while (!stop_)
+	{
+		if (watched_.empty())
+		{
+			cv_.wait(lk);
+			continue;
+		}
+
+		std::uint64_t n = 0;
+		for (auto it = watched_.begin(); it != watched_.end();)
+		{
+			auto cur = it++;
+			if (cur->is_ready())
+			{
+				fired_.splice(fired_.end(), watched_, cur);
+				++n;
+			}
+		}
+
+		if (n != 0)
+			(void)::write(fd_, &n, sizeof(n));
+
+		cv_.wait_for(lk, interval_);
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,182 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <mpiex/fusion.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace mpiex
+{
+
+namespace
+{
+
+struct __fusion_entry
+{
+	void* q;
+	size_t offset;
+	size_t bytes;
+};
+
+struct __fusion_group
+{
+	MPI_Datatype dt;
+	MPI_Op op;
+	size_t elem;
+	std::vector<char> buf;
+	std::vector<__fusion_entry> entries;
+
+	// the operation of the group, once flushed
+	std::shared_ptr<shared_future<void>> done;
+};
+
+}
+
+struct __fusion_core
+{
+	communicator comm;
+	size_t budget;
+	std::mutex mut;
+	std::vector<__fusion_group> groups;
+	size_t bytes = 0;
+	std::vector<shared_future<void>> inflight;
+
+	void flush();
+};
+
+// called with mut held; the groups go in the order they were opened
+void
+__fusion_core::flush()
+{
+	inflight.erase(std::remove_if(inflight.begin(), inflight.end(),
+	    [](shared_future<void>& f) { return f.is_ready(); }),
+	    inflight.end());
+
+	for (auto& g : groups)
+	{
+		auto done = g.done;
+		*done = __make_mpi_staged_assoc_state<void>(
+		    [g = std::move(g), c = comm.get(), stage = 0](
+		    std::vector<MPI_Request>& reqs) mutable
+		    {
+			if (stage++ == 0)
+			{
+				MPI_Request r;
+				MPI_Iallreduce(MPI_IN_PLACE, g.buf.data(),
+				    int(g.buf.size() / g.elem), g.dt, g.op, c,
+				    &r);
+				reqs.push_back(r);
+				return true;
+			}
+
+			for (auto& e : g.entries)
+				std::memcpy(e.q, g.buf.data() + e.offset,
+				    e.bytes);
+			return false;
+		    });
+		inflight.push_back(*done);
+	}
+
+	groups.clear();
+	bytes = 0;
+}
+
+fusion_buffer::fusion_buffer(communicator comm, size_t budget) :
+	core_(std::make_shared<__fusion_core>())
+{
+	core_->comm = comm;
+	core_->budget = budget;
+}
+
+fusion_buffer::~fusion_buffer()
+{
+	flush();
+
+	std::lock_guard<std::mutex> lk(core_->mut);
+	for (auto& f : core_->inflight)
+		f.wait();
+}
+
+void
+fusion_buffer::flush()
+{
+	std::lock_guard<std::mutex> lk(core_->mut);
+	core_->flush();
+}
+
+size_t
+fusion_buffer::size() const
+{
+	std::lock_guard<std::mutex> lk(core_->mut);
+	return core_->bytes;
+}
+
+future<void>
+fusion_buffer::add(MPI_Datatype dt, MPI_Op op, size_t elem, void const* p,
+    void* q, size_t sz)
+{
+	std::lock_guard<std::mutex> lk(core_->mut);
+
+	auto it = std::find_if(core_->groups.begin(), core_->groups.end(),
+	    [&](__fusion_group const& g) { return g.dt == dt && g.op == op; });
+	if (it == core_->groups.end())
+		it = core_->groups.insert(it, { dt, op, elem, {}, {},
+		    std::make_shared<shared_future<void>>() });
+
+	// waiting on an operation not yet flushed flushes it; the result is
+	// unpacked by the group operation, polled by each of its futures
+	auto f = __make_mpi_pending_assoc_state(
+	    [core = core_, done = it->done](bool start)
+	    {
+		shared_future<void> g;
+		{
+			std::lock_guard<std::mutex> lk(core->mut);
+			if (start && !done->valid())
+				core->flush();
+			g = *done;
+		}
+
+		if (!g.valid() || !g.is_ready())
+			return false;
+		g.get();
+		return true;
+	    });
+
+	auto n = sz * elem;
+	auto from = static_cast<char const*>(p);
+	it->entries.push_back({ q, it->buf.size(), n });
+	it->buf.insert(it->buf.end(), from, from + n);
+	core_->bytes += n;
+
+	if (core_->bytes >= core_->budget)
+		core_->flush();
+
+	return f;
+}
+
+}
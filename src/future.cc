@@ -12,6 +12,7 @@
 #include <mpiex/future.h>
 
 #include <string>
+#include <algorithm>
 
 namespace mpiex
 {
@@ -84,10 +85,16 @@ __assoc_sub_state::__sub_wait(unique_lock<mutex>& __lk)
         }
         else
             while (!__is_ready())
-                __cv_.wait(__lk);
+                __sub_block(__lk);
     }
 }
 
+void
+__assoc_sub_state::__sub_block(unique_lock<mutex>& __lk)
+{
+    __cv_.wait(__lk);
+}
+
 void
 __assoc_sub_state::__execute()
 {
@@ -122,6 +129,75 @@ future<void>::get()
     __s->copy();
 }
 
+namespace
+{
+
+struct __mpi_progress_registry
+{
+    std::recursive_mutex __mut_;
+    std::vector<__mpi_progress_node*> __nodes_;
+    bool __polling_ = false;
+};
+
+__mpi_progress_registry&
+__get_mpi_progress_registry()
+{
+    static __mpi_progress_registry __r;
+    return __r;
+}
+
+thread_local bool __in_mpi_progress = false;
+
+}
+
+void
+__mpi_progress_register(__mpi_progress_node* __n)
+{
+    auto& __r = __get_mpi_progress_registry();
+    lock_guard<std::recursive_mutex> __lk(__r.__mut_);
+    __r.__nodes_.push_back(__n);
+}
+
+void
+__mpi_progress_unregister(__mpi_progress_node* __n)
+{
+    auto& __r = __get_mpi_progress_registry();
+    lock_guard<std::recursive_mutex> __lk(__r.__mut_);
+    auto __it = std::find(__r.__nodes_.begin(), __r.__nodes_.end(), __n);
+    if (__it == __r.__nodes_.end())
+        return;
+    // a node may complete, and leave, while it is being polled
+    if (__r.__polling_)
+        *__it = nullptr;
+    else
+        __r.__nodes_.erase(__it);
+}
+
+bool
+__mpi_progress()
+{
+    // the nodes being polled by this thread are locked by this thread
+    if (__in_mpi_progress)
+        return true;
+
+    auto& __r = __get_mpi_progress_registry();
+    lock_guard<std::recursive_mutex> __lk(__r.__mut_);
+    if (__r.__nodes_.empty())
+        return false;
+
+    __in_mpi_progress = true;
+    __r.__polling_ = true;
+    for (size_t __i = 0; __i < __r.__nodes_.size(); ++__i)
+        if (__r.__nodes_[__i] != nullptr)
+            __r.__nodes_[__i]->__poll();
+    __r.__polling_ = false;
+    __in_mpi_progress = false;
+
+    __r.__nodes_.erase(std::remove(__r.__nodes_.begin(), __r.__nodes_.end(),
+                                   nullptr), __r.__nodes_.end());
+    return true;
+}
+
 promise<void>::promise()
     : __state_(new __assoc_sub_state)
 {
@@ -0,0 +1,158 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <mpiex/halo.h>
+
+namespace mpiex
+{
+
+namespace
+{
+
+// the cells of one side of the array along a dimension: -1 for the low
+// side, 0 for the interior, +1 for the high side
+void
+__halo_block(int side, int extent, int ghost, bool outer, int& start,
+    int& size)
+{
+	if (side == 0)
+	{
+		start = ghost;
+		size = extent;
+	}
+	else
+	{
+		size = ghost;
+		if (side < 0)
+			start = outer ? 0 : ghost;
+		else
+			start = outer ? ghost + extent : extent;
+	}
+}
+
+MPI_Datatype
+__halo_type(MPI_Datatype dt, std::vector<int> const& full,
+    std::vector<int> const& extents, std::vector<int> const& dir, int ghost,
+    bool outer)
+{
+	auto nd = full.size();
+	std::vector<int> sub(nd), start(nd);
+	for (size_t i = 0; i < nd; ++i)
+		__halo_block(dir[i], extents[i], ghost, outer, start[i],
+		    sub[i]);
+
+	MPI_Datatype t;
+	MPI_Type_create_subarray(int(nd), full.data(), sub.data(),
+	    start.data(), MPI_ORDER_C, dt, &t);
+	MPI_Type_commit(&t);
+	return t;
+}
+
+}
+
+void
+halo_exchange::init(topo_communicator const& comm, MPI_Datatype dt, void* p,
+    std::vector<int> const& extents, int ghost, bool corners)
+{
+	auto nd = extents.size();
+	std::vector<int> full(nd);
+	for (size_t i = 0; i < nd; ++i)
+		full[i] = extents[i] + 2 * ghost;
+
+	MPI_Comm_dup(comm.get(), &comm_);
+
+	// every direction in {-1, 0, 1}^nd but the origin; the message to the
+	// direction d is tagged with the index of d, and received from the
+	// neighbor at -d
+	int ndirs = 1;
+	for (size_t i = 0; i < nd; ++i)
+		ndirs *= 3;
+
+	std::vector<int> dir(nd), at(nd);
+	for (int k = 0; k < ndirs; ++k)
+	{
+		int nonzero = 0;
+		for (size_t i = nd, v = size_t(k); i-- > 0; v /= 3)
+		{
+			dir[i] = int(v % 3) - 1;
+			nonzero += dir[i] != 0;
+		}
+		if (nonzero == 0 || (!corners && nonzero > 1))
+			continue;
+
+		for (size_t i = 0; i < nd; ++i)
+			at[i] = comm.coords()[i] + dir[i];
+		int peer = comm.rank_at(at);
+		if (peer == MPI_PROC_NULL)
+			continue;
+
+		MPI_Request r;
+		auto st = __halo_type(dt, full, extents, dir, ghost, false);
+		types_.push_back(st);
+		MPI_Send_init(p, 1, st, peer, k, comm_, &r);
+		reqs_.push_back(r);
+
+		auto rt = __halo_type(dt, full, extents, dir, ghost, true);
+		types_.push_back(rt);
+		MPI_Recv_init(p, 1, rt, peer, ndirs - 1 - k, comm_, &r);
+		reqs_.push_back(r);
+	}
+}
+
+halo_exchange::~halo_exchange()
+{
+	MPI_Waitall(int(reqs_.size()), reqs_.data(), MPI_STATUSES_IGNORE);
+	for (auto& r : reqs_)
+		MPI_Request_free(&r);
+	for (auto& t : types_)
+		MPI_Type_free(&t);
+	MPI_Comm_free(&comm_);
+}
+
+void
+halo_exchange::start()
+{
+	MPI_Startall(int(reqs_.size()), reqs_.data());
+}
+
+future<void>
+halo_exchange::finish()
+{
+	// persistent requests stay allocated once complete
+	return __make_mpi_staged_assoc_state<void>(
+	    [reqs = reqs_](std::vector<MPI_Request>& v)
+	    {
+		v = reqs;
+		return false;
+	    });
+}
+
+size_t
+halo_exchange::size() const
+{
+	return reqs_.size() / 2;
+}
+
+}
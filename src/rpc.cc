@@ -0,0 +1,269 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <mpiex/rpc.h>
+
+#include <climits>
+#include <stdexcept>
+#include <string>
+
+namespace mpiex
+{
+
+namespace
+{
+
+enum
+{
+	call_tag,
+	result_tag,
+};
+
+}
+
+__rpc_engine::__rpc_engine(communicator c, size_t batch) :
+	comm(c.dup()), batch_(batch), out_(size_t(comm.size())), seq_(0),
+	serving_(false)
+{
+	__mpi_progress_register(this);
+}
+
+__rpc_engine::~__rpc_engine()
+{
+	__mpi_progress_unregister(this);
+
+	int done;
+	MPI_Finalized(&done);
+	if (done)
+		return;
+
+	for (auto& s : sends_)
+		MPI_Wait(&s.req, MPI_STATUS_IGNORE);
+}
+
+int
+__rpc_engine::add(handler h)
+{
+	std::lock_guard<std::recursive_mutex> lk(mut);
+	handlers_.push_back(std::move(h));
+	return int(handlers_.size() - 1);
+}
+
+std::vector<char>&
+__rpc_engine::begin_call(int dest, int id, reply r)
+{
+	int call = seq_;
+	seq_ = seq_ == INT_MAX ? 0 : seq_ + 1;
+	pending_.emplace(call, std::move(r));
+
+	auto& buf = out_[size_t(dest)];
+	__rpc_pack(call, buf, comm.get());
+	__rpc_pack(id, buf, comm.get());
+	return buf;
+}
+
+void
+__rpc_engine::end_call(int dest)
+{
+	if (out_[size_t(dest)].size() >= batch_)
+		flush(dest);
+}
+
+void
+__rpc_engine::flush(int dest)
+{
+	std::lock_guard<std::recursive_mutex> lk(mut);
+	auto& buf = out_[size_t(dest)];
+	if (buf.empty())
+		return;
+
+	post(dest, call_tag, std::move(buf));
+	buf.clear();
+}
+
+void
+__rpc_engine::post(int dest, int tag, std::vector<char> data)
+{
+	// moving a vector keeps its buffer where it is
+	sends_.push_back({ std::move(data), MPI_REQUEST_NULL });
+	auto& s = sends_.back();
+	MPI_Isend(s.data.data(), int(s.data.size()), MPI_PACKED, dest, tag,
+	    comm.get(), &s.req);
+}
+
+void
+__rpc_engine::progress(bool flush_all)
+{
+	std::lock_guard<std::recursive_mutex> lk(mut);
+
+	if (flush_all)
+		for (int i = 0; i < comm.size(); ++i)
+			flush(i);
+
+	for (size_t i = 0; i < sends_.size();)
+	{
+		int flag;
+		MPI_Test(&sends_[i].req, &flag, MPI_STATUS_IGNORE);
+		if (flag)
+		{
+			sends_[i] = std::move(sends_.back());
+			sends_.pop_back();
+		}
+		else
+			++i;
+	}
+
+	for (;;)
+	{
+		int flag;
+		MPI_Message msg;
+		MPI_Status st;
+		MPI_Improbe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm.get(), &flag, &msg,
+		    &st);
+		if (!flag)
+			break;
+
+		int n;
+		MPI_Get_count(&st, MPI_PACKED, &n);
+		std::vector<char> data(static_cast<size_t>(n));
+		MPI_Mrecv(data.data(), n, MPI_PACKED, &msg, MPI_STATUS_IGNORE);
+
+		if (st.MPI_TAG == call_tag)
+			in_.push_back({ st.MPI_SOURCE, std::move(data), 0, {} });
+		else
+			complete(data);
+	}
+
+	// a handler waiting on a call of its own lands here again; the
+	// batches received meanwhile wait for it to return
+	if (serving_)
+		return;
+
+	serving_ = true;
+	while (!in_.empty() && serve(in_.front()))
+	{
+		post(in_.front().source, result_tag, std::move(in_.front().out));
+		in_.pop_front();
+	}
+	serving_ = false;
+}
+
+// blocking on an unrelated future serves the calls received, but leaves
+// the batches to their budgets
+void
+__rpc_engine::__poll()
+{
+	progress(false);
+}
+
+bool
+__rpc_engine::serve(batch& b)
+{
+	auto c = comm.get();
+	int n = int(b.data.size());
+
+	while (b.pos < n)
+	{
+		int pos = b.pos;
+		auto call = __rpc_unpack<int>(b.data.data(), n, pos, c);
+		auto id = __rpc_unpack<int>(b.data.data(), n, pos, c);
+
+		// not registered on this process yet
+		if (size_t(id) >= handlers_.size())
+			return false;
+
+		__rpc_pack(call, b.out, c);
+		auto mark = b.out.size();
+		__rpc_pack(0, b.out, c);
+
+		std::string what;
+		try
+		{
+			handlers_[size_t(id)](b.data.data(), n, pos, b.out);
+		}
+		catch (std::exception const& e)
+		{
+			what = e.what();
+		}
+		catch (...)
+		{
+			what = "unknown exception";
+		}
+
+		b.pos = pos;
+		if (what.empty())
+			continue;
+
+		// replace the status, and whatever was packed after it
+		b.out.resize(mark);
+		__rpc_pack(1, b.out, c);
+		__rpc_pack(int(what.size()), b.out, c);
+		int sz;
+		MPI_Pack_size(int(what.size()), MPI_CHAR, c, &sz);
+		int at = int(b.out.size());
+		b.out.resize(b.out.size() + size_t(sz));
+		MPI_Pack(what.data(), int(what.size()), MPI_CHAR, b.out.data(),
+		    int(b.out.size()), &at, c);
+		b.out.resize(size_t(at));
+	}
+
+	return true;
+}
+
+void
+__rpc_engine::complete(std::vector<char> const& data)
+{
+	auto c = comm.get();
+	int n = int(data.size());
+	int pos = 0;
+
+	while (pos < n)
+	{
+		auto call = __rpc_unpack<int>(data.data(), n, pos, c);
+		auto status = __rpc_unpack<int>(data.data(), n, pos, c);
+
+		auto it = pending_.find(call);
+		auto r = std::move(it->second);
+		pending_.erase(it);
+
+		if (status == 0)
+			r(data.data(), n, pos, nullptr);
+		else
+		{
+			auto len = __rpc_unpack<int>(data.data(), n, pos, c);
+			std::string what(size_t(len), '\0');
+			MPI_Unpack(data.data(), n, &pos, &what[0], len, MPI_CHAR,
+			    c);
+			r(nullptr, 0, pos,
+			    std::make_exception_ptr(std::runtime_error(what)));
+		}
+	}
+}
+
+rpc_communicator::rpc_communicator(communicator comm, size_t batch) :
+	communicator(comm), e_(std::make_shared<__rpc_engine>(comm, batch))
+{}
+
+}
@@ -0,0 +1,155 @@
+/*-
+ * Copyright (c) 2016 Zhihao Yuan.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <mpiex/topology.h>
+
+namespace mpiex
+{
+
+struct __topology
+{
+	std::vector<int> sources;
+	std::vector<int> destinations;
+	std::vector<int> dims;
+	std::vector<bool> periods;
+	std::vector<int> coords;
+};
+
+topo_communicator::topo_communicator(MPI_Comm comm,
+    std::shared_ptr<__topology> t) :
+	shared_communicator(comm), topo_(std::move(t))
+{}
+
+std::vector<int> const&
+topo_communicator::sources() const
+{
+	return topo_->sources;
+}
+
+std::vector<int> const&
+topo_communicator::destinations() const
+{
+	return topo_->destinations;
+}
+
+std::vector<int> const&
+topo_communicator::dims() const
+{
+	return topo_->dims;
+}
+
+std::vector<bool> const&
+topo_communicator::periods() const
+{
+	return topo_->periods;
+}
+
+std::vector<int> const&
+topo_communicator::coords() const
+{
+	return topo_->coords;
+}
+
+std::pair<int, int>
+topo_communicator::shift(int dim, int disp) const
+{
+	std::pair<int, int> r;
+	MPI_Cart_shift(get(), dim, disp, &r.first, &r.second);
+	return r;
+}
+
+int
+topo_communicator::rank_at(std::vector<int> coords) const
+{
+	// MPI_Cart_rank is erroneous beyond a non-periodic boundary
+	for (size_t i = 0; i < coords.size(); ++i)
+		if (!topo_->periods[i] &&
+		    (coords[i] < 0 || coords[i] >= topo_->dims[i]))
+			return MPI_PROC_NULL;
+
+	int r;
+	MPI_Cart_rank(get(), coords.data(), &r);
+	return r;
+}
+
+topo_communicator
+cart_create(communicator comm, std::vector<int> dims,
+    std::vector<bool> periods, bool reorder)
+{
+	auto t = std::make_shared<__topology>();
+	int nd = int(dims.size());
+	std::vector<int> per(periods.begin(), periods.end());
+	per.resize(dims.size());
+
+	MPI_Comm c;
+	MPI_Dims_create(comm.size(), nd, dims.data());
+	MPI_Cart_create(comm.get(), nd, dims.data(), per.data(), reorder, &c);
+	if (c == MPI_COMM_NULL)
+		return topo_communicator(c, std::move(t));
+
+	t->dims = dims;
+	t->periods.assign(per.begin(), per.end());
+	t->coords.resize(dims.size());
+	int rank;
+	MPI_Comm_rank(c, &rank);
+	MPI_Cart_coords(c, rank, nd, t->coords.data());
+
+	// per dimension, the negative direction first, as the neighborhood
+	// collectives do
+	for (int d = 0; d < nd; ++d)
+	{
+		int lo, hi;
+		MPI_Cart_shift(c, d, 1, &lo, &hi);
+		t->sources.push_back(lo);
+		t->sources.push_back(hi);
+	}
+	t->destinations = t->sources;
+
+	return topo_communicator(c, std::move(t));
+}
+
+topo_communicator
+dist_graph_create_adjacent(communicator comm, std::vector<int> const& sources,
+    std::vector<int> const& destinations, bool reorder)
+{
+	auto t = std::make_shared<__topology>();
+
+	MPI_Comm c;
+	MPI_Dist_graph_create_adjacent(comm.get(), int(sources.size()),
+	    sources.data(), MPI_UNWEIGHTED, int(destinations.size()),
+	    destinations.data(), MPI_UNWEIGHTED, MPI_INFO_NULL, reorder, &c);
+
+	// the ranks in the new communicator, if reordered
+	int in, out, weighted;
+	MPI_Dist_graph_neighbors_count(c, &in, &out, &weighted);
+	t->sources.resize(in);
+	t->destinations.resize(out);
+	MPI_Dist_graph_neighbors(c, in, t->sources.data(), MPI_UNWEIGHTED,
+	    out, t->destinations.data(), MPI_UNWEIGHTED);
+
+	return topo_communicator(c, std::move(t));
+}
+
+}
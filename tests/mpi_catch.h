@@ -3,9 +3,17 @@
 
 #include <mpi.h>
 
+// the thread support level MPI_Init_thread provided
+inline int& mpi_thread_provided()
+{
+	static int level = MPI_THREAD_SINGLE;
+	return level;
+}
+
 int main(int argc, char* argv[])
 {
-	MPI_Init(&argc, &argv);
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE,
+	    &mpi_thread_provided());
 	int r = Catch::Session().run(argc, argv);
 	MPI_Finalize();
 
@@ -0,0 +1,405 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+TEST_CASE("barrier")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	// the last rank enters only after rank 0 has seen the barrier open
+	if (rank == 0)
+	{
+		auto f = barrier(comm);
+		if (p > 1)
+		{
+			REQUIRE_FALSE(f.is_ready());
+			send(comm, p - 1, 1).get();
+		}
+		f.get();
+	}
+	else if (rank == p - 1)
+	{
+		mpiex::receive<int>(comm, 0).get();
+		barrier(comm).get();
+	}
+	else
+		barrier(comm).get();
+}
+
+TEST_CASE("bcast")
+{
+	auto comm = mpiex::communicator();
+	auto rank = comm.rank();
+
+	int x = rank == 1 ? 42 : 0;
+	bcast(comm, 1, x).get();
+	REQUIRE(x == 42);
+
+	std::vector<double> v(1000);
+	if (rank == 0)
+		std::iota(v.begin(), v.end(), 0.0);
+
+	auto fs = mpiex::bcast_pipelined(comm, 0, v.data(), v.size(), 64);
+	REQUIRE(fs.size() == 16);
+
+	for (size_t i = 0; i < fs.size(); ++i)
+	{
+		fs[i].get();
+		REQUIRE(v[i * 64] == double(i * 64));
+	}
+	REQUIRE(v.back() == 999.0);
+
+	// not split at all
+	if (rank != 0)
+		std::fill(v.begin(), v.end(), 0.0);
+	fs = mpiex::bcast_pipelined(comm, 0, v.data(), v.size(), 0);
+	REQUIRE(fs.size() == 1);
+	fs[0].get();
+	REQUIRE(v.back() == 999.0);
+}
+
+TEST_CASE("gather and scatter")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	auto g = gather(comm, 0, rank * 2).get();
+	auto a = allgather(comm, rank * 3).get();
+	REQUIRE(a.size() == size_t(p));
+	for (int i = 0; i < p; ++i)
+		REQUIRE(a[i] == i * 3);
+
+	if (rank == 0)
+	{
+		REQUIRE(g.size() == size_t(p));
+		for (int i = 0; i < p; ++i)
+			REQUIRE(g[i] == i * 2);
+	}
+	else
+		REQUIRE(g.empty());
+
+	auto x = mpiex::scatter<int>(comm, 0, rank == 0 ? a.data() : nullptr);
+	REQUIRE(x.get() == rank * 3);
+}
+
+TEST_CASE("v-variants with count exchange")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	// rank i contributes i + 1 copies of i
+	std::vector<int> mine(rank + 1, rank);
+
+	auto f1 = mpiex::gatherv(comm, 0, mine.data(), mine.size());
+	auto f2 = mpiex::allgatherv(comm, mine.data(), mine.size());
+	auto g = f1.get();
+	auto a = f2.get();
+
+	REQUIRE(a.data.size() == size_t(p * (p + 1) / 2));
+	for (int i = 0; i < p; ++i)
+	{
+		REQUIRE(a.counts[i] == i + 1);
+		REQUIRE(a.data[a.displs[i]] == i);
+		REQUIRE(a.data[a.displs[i] + i] == i);
+	}
+
+	if (rank == 0)
+	{
+		REQUIRE(g.data == a.data);
+		REQUIRE(g.displs == a.displs);
+	}
+	else
+		REQUIRE(g.data.empty());
+
+	auto s = mpiex::scatterv(comm, 0, a.data.data(), a.counts.data()).get();
+	REQUIRE(s == mine);
+}
+
+TEST_CASE("alltoall")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	std::vector<int> x(p), y(p);
+	for (int i = 0; i < p; ++i)
+		x[i] = rank * 100 + i;
+
+	alltoall(comm, x.data(), y.data(), 1).get();
+	for (int i = 0; i < p; ++i)
+		REQUIRE(y[i] == i * 100 + rank);
+
+	std::vector<long> bx(p * 3), by(p * 3);
+	for (int i = 0; i < p * 3; ++i)
+		bx[i] = rank * 1000 + i;
+
+	// two in flight on the same communicator
+	auto f1 = mpiex::alltoall_bruck(comm, bx.data(), by.data(), 3);
+	auto f2 = mpiex::alltoall_bruck(comm, x.data(), y.data(), 1);
+	f2.get();
+	f1.get();
+	for (int i = 0; i < p; ++i)
+	{
+		REQUIRE(y[i] == i * 100 + rank);
+		for (int j = 0; j < 3; ++j)
+			REQUIRE(by[i * 3 + j] == i * 1000 + rank * 3 + j);
+	}
+
+	// i + 1 copies of each value are destined to rank i
+	std::vector<int> v;
+	for (int i = p - 1; i >= 0; --i)
+		v.insert(v.end(), i + 1, rank * 100 + i);
+
+	auto g = alltoallv(comm,
+	    mpiex::bucket(comm, v, [](int x) { return x % 100; })).get();
+
+	REQUIRE(g.data.size() == size_t(p * (rank + 1)));
+	for (int i = 0; i < p; ++i)
+	{
+		REQUIRE(g.counts[i] == rank + 1);
+		REQUIRE(g.data[g.displs[i]] == i * 100 + rank);
+	}
+}
+
+TEST_CASE("reductions")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	REQUIRE(allreduce(comm, rank + 1, std::plus<>()).get() ==
+	    p * (p + 1) / 2);
+
+	std::vector<int> x(p * 2), y(2);
+	for (int i = 0; i < p * 2; ++i)
+		x[i] = rank + i;
+
+	reduce_scatter_block(comm, x.data(), y.data(), 2, std::plus<>()).get();
+	REQUIRE(y[0] == p * (p - 1) / 2 + rank * 2 * p);
+	REQUIRE(y[1] == p * (p - 1) / 2 + (rank * 2 + 1) * p);
+
+	// lengths not divisible by the number of nodes, and tiny chunks
+	for (size_t n : { 0, 3, 1000, 1001 })
+	{
+		std::vector<double> v(n), w(n);
+		for (size_t i = 0; i < n; ++i)
+			v[i] = double(rank * i);
+
+		allreduce_ring(comm, v.data(), w.data(), n, std::plus<>(), 7)
+		    .get();
+		allreduce_ring(comm, v.data(), v.data(), n, std::plus<>())
+		    .get();
+
+		for (size_t i = 0; i < n; ++i)
+			REQUIRE(w[i] == double(p * (p - 1) / 2 * i));
+		REQUIRE(v == w);
+	}
+}
+
+TEST_CASE("scans")
+{
+	auto comm = mpiex::communicator();
+	auto rank = comm.rank();
+
+	REQUIRE(scan(comm, rank + 1, std::plus<>()).get() ==
+	    (rank + 1) * (rank + 2) / 2);
+	auto ex = exscan(comm, rank + 1, std::plus<>()).get();
+	if (rank != 0)
+		REQUIRE(ex == rank * (rank + 1) / 2);
+
+	// without an MPI_Op, and not commutative
+	auto sum = [](long a, long b) { return a + b; };
+	auto first = [](int a, int) { return a; };
+	auto last = [](int, int b) { return b; };
+
+	REQUIRE(scan(comm, rank, first).get() == 0);
+	REQUIRE(scan(comm, rank, last).get() == rank);
+	if (rank != 0)
+	{
+		REQUIRE(exscan(comm, rank, first).get() == 0);
+		REQUIRE(exscan(comm, rank, last).get() == rank - 1);
+	}
+	else
+	{
+		exscan(comm, rank, first).get();
+		exscan(comm, rank, last).get();
+	}
+
+	for (size_t n : { 0, 1, 100 })
+	{
+		std::vector<long> v(n), w(n), x(n), y(n);
+		for (size_t i = 0; i < n; ++i)
+			v[i] = long(rank + i);
+
+		scan(comm, v.data(), w.data(), n, std::plus<>()).get();
+		exscan(comm, v.data(), x.data(), n, sum).get();
+		scan(comm, v.data(), y.data(), n, sum).get();
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			auto below = long(rank * (rank - 1) / 2 + rank * i);
+			REQUIRE(w[i] == below + long(rank + i));
+			REQUIRE(y[i] == w[i]);
+			if (rank != 0)
+				REQUIRE(x[i] == below);
+		}
+	}
+}
+
+TEST_CASE("tree collectives")
+{
+	using mpiex::tree_shape;
+
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	std::vector<int> x(10, rank + 1), y(10), z(10);
+	auto sum = p * (p + 1) / 2;
+
+	for (auto shape : { tree_shape::kary, tree_shape::binomial,
+	    tree_shape::recursive_doubling })
+		for (int k : { 2, 3 })
+			for (int root : { 0, p - 1 })
+			{
+				y.assign(10, 0);
+				z.assign(10, 0);
+				auto f1 = tree_reduce(comm, root, x.data(),
+				    y.data(), 10, std::plus<>(), shape, k);
+				auto f2 = tree_allreduce(comm, x.data(), z.data(),
+				    10, std::plus<>(), shape, k);
+				f2.get();
+				f1.get();
+
+				REQUIRE(z == std::vector<int>(10, sum));
+				if (rank == root)
+					REQUIRE(y == std::vector<int>(10, sum));
+
+				std::vector<int> b(3, rank == root ? 7 : 0);
+				tree_bcast(comm, root, b.data(), 3, shape, k).get();
+				REQUIRE(b == std::vector<int>(3, 7));
+			}
+}
+
+TEST_CASE("node-aware collectives")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	std::vector<int> x(10, rank + 1), y(10), z(10);
+	auto sum = p * (p + 1) / 2;
+
+	for (int root : { 0, p - 1 })
+	{
+		y.assign(10, 0);
+		z.assign(10, 0);
+		auto f1 = hier_reduce(comm, root, x.data(), y.data(), 10,
+		    std::plus<>());
+		auto f2 = hier_allreduce(comm, x.data(), z.data(), 10,
+		    [](int a, int b) { return a + b; });
+		f2.get();
+		f1.get();
+
+		REQUIRE(z == std::vector<int>(10, sum));
+		if (rank == root)
+			REQUIRE(y == std::vector<int>(10, sum));
+
+		std::vector<int> b(3, rank == root ? 7 : 0);
+		hier_bcast(comm, root, b.data(), 3).get();
+		REQUIRE(b == std::vector<int>(3, 7));
+	}
+}
+
+TEST_CASE("autotuned collectives")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+	auto file = "test_collectives.tuning";
+
+	if (rank == 0)
+		std::remove(file);
+	mpiex::tuning().autotune_file = file;
+
+	for (int round = 0; round < 2; ++round)
+		for (size_t n : { 1, 100, 5000 })
+		{
+			std::vector<int> x(n, rank + 1), y(n), z(n);
+			auto sum = p * (p + 1) / 2;
+
+			tuned_reduce(comm, p - 1, x.data(), y.data(), n,
+			    std::plus<>()).get();
+			tuned_allreduce(comm, x.data(), z.data(), n,
+			    [](int a, int b) { return a + b; }).get();
+			if (rank == p - 1)
+				REQUIRE(y == std::vector<int>(n, sum));
+			REQUIRE(z == std::vector<int>(n, sum));
+
+			std::vector<int> b(n, rank == 0 ? 7 : 0);
+			tuned_bcast(comm, 0, b.data(), n).get();
+			REQUIRE(b == std::vector<int>(n, 7));
+		}
+
+	// one entry per operation and size class, measured once
+	if (rank == 0)
+	{
+		std::ifstream in(file);
+		std::string line;
+		int lines = 0;
+		while (std::getline(in, line))
+			++lines;
+		REQUIRE(lines == 9);
+		std::remove(file);
+	}
+	mpiex::tuning().autotune_file.clear();
+}
+
+TEST_CASE("tree reduce versus MPI_Ireduce", "[.][benchmark]")
+{
+	using mpiex::tree_shape;
+
+	auto comm = mpiex::communicator();
+	auto rank = comm.rank();
+
+	auto time = [&](auto f)
+	{
+		MPI_Barrier(comm.get());
+		auto t = MPI_Wtime();
+		for (int i = 0; i < 20; ++i)
+			f().get();
+		return (MPI_Wtime() - t) / 20 * 1e6;
+	};
+
+	for (size_t n : { 1, 1024, 1 << 18 })
+	{
+		std::vector<float> x(n, 1.0f), y(n);
+		auto native = time([&] {
+			return reduce(comm, 0, x.data(), y.data(), n,
+			    std::plus<>());
+		    });
+		auto binomial = time([&] {
+			return tree_reduce(comm, 0, x.data(), y.data(), n,
+			    std::plus<>());
+		    });
+		auto kary = time([&] {
+			return tree_reduce(comm, 0, x.data(), y.data(), n,
+			    std::plus<>(), tree_shape::kary, 4);
+		    });
+
+		if (rank == 0)
+			std::cout << n << " floats: MPI_Ireduce " << native
+			    << "us, binomial " << binomial << "us, 4-ary "
+			    << kary << "us\n";
+	}
+}
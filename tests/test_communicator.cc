@@ -0,0 +1,63 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+static int freed;
+
+static int
+count_free(MPI_Comm, int, void*, void*)
+{
+	++freed;
+	return MPI_SUCCESS;
+}
+
+TEST_CASE("owning communicators")
+{
+	auto world = mpiex::communicator();
+	auto p = world.size();
+	auto rank = world.rank();
+
+	int keyval;
+	MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, count_free, &keyval,
+	    nullptr);
+	freed = 0;
+
+	{
+		auto c = world.dup();
+		REQUIRE(c.get() != world.get());
+		REQUIRE(c.rank() == rank);
+		REQUIRE(c.size() == p);
+		MPI_Comm_set_attr(c.get(), keyval, nullptr);
+
+		auto copy = c;
+		{
+			auto last = copy;
+		}
+		REQUIRE(freed == 0);
+	}
+	REQUIRE(freed == 1);
+
+	auto halves = world.split(rank % 2, -rank);
+	REQUIRE(halves.size() == (p + 1 - rank % 2) / 2);
+	REQUIRE(halves.rank() == (p - 1 - rank) / 2);
+
+	auto none = world.split(rank == 0 ? 0 : MPI_UNDEFINED);
+	if (rank == 0)
+		REQUIRE(none.size() == 1);
+	else
+	{
+		REQUIRE(none.get() == MPI_COMM_NULL);
+		REQUIRE(none.rank() == MPI_UNDEFINED);
+	}
+
+	auto node = world.split_type();
+	REQUIRE(node.size() <= p);
+
+	auto f = idup(halves);
+	auto d = f.get();
+	REQUIRE(d.get() != halves.get());
+	REQUIRE(d.rank() == halves.rank());
+	REQUIRE(allreduce(d, 1, std::plus<>()).get() == halves.size());
+
+	MPI_Comm_free_keyval(&keyval);
+}
@@ -0,0 +1,76 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <algorithm>
+
+TEST_CASE("completion queue")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+	auto next = (rank + 1) % p;
+	auto prev = (rank + p - 1) % p;
+
+	int x = rank * 10;
+	int y[2] = {};
+
+	mpiex::completion_queue cq;
+	send(cq, 1, comm, next, x);
+	send(cq, 2, comm, prev, x, 1);
+	recv(cq, 3, comm, prev, y[0]);
+	cq.post(4, [&]
+	    {
+		MPI_Request r;
+		MPI_Irecv(&y[1], 1, MPI_INT, next, 1, comm.get(), &r);
+		return r;
+	    });
+
+	REQUIRE(cq.size() == 4);
+
+	std::vector<std::uint64_t> tags;
+	while (!cq.empty())
+	{
+		for (auto& c : cq.poll(3))
+			tags.push_back(c.tag);
+	}
+
+	std::sort(tags.begin(), tags.end());
+	REQUIRE(tags == (std::vector<std::uint64_t>{ 1, 2, 3, 4 }));
+	REQUIRE(y[0] == prev * 10);
+	REQUIRE(y[1] == next * 10);
+}
+
+TEST_CASE("completion queue with persistent requests")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+	auto next = (rank + 1) % p;
+	auto prev = (rank + p - 1) % p;
+
+	int x = 0;
+	int y = -1;
+	MPI_Request r[2];
+	MPI_Send_init(&x, 1, MPI_INT, next, 2, comm.get(), &r[0]);
+	MPI_Recv_init(&y, 1, MPI_INT, prev, 2, comm.get(), &r[1]);
+
+	mpiex::completion_queue cq;
+	for (int round = 0; round < 3; ++round)
+	{
+		x = rank * 10 + round;
+		MPI_Startall(2, r);
+		cq.post(1, r[0]);
+		cq.post(2, r[1]);
+
+		size_t n = 0;
+		while (!cq.empty())
+			n += cq.poll(2).size();
+
+		REQUIRE(n == 2);
+		REQUIRE(y == prev * 10 + round);
+	}
+
+	MPI_Request_free(&r[0]);
+	MPI_Request_free(&r[1]);
+}
@@ -0,0 +1,104 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <cmath>
+#include <vector>
+
+TEST_CASE("half-precision conversions")
+{
+	using mpiex::__to_fp16;
+	using mpiex::__from_fp16;
+
+	REQUIRE(__to_fp16(1.0f) == 0x3c00);
+	REQUIRE(__to_fp16(-2.0f) == 0xc000);
+	REQUIRE(__to_fp16(65504.0f) == 0x7bff);
+	REQUIRE(__to_fp16(70000.0f) == 0x7c00);
+	REQUIRE(__to_fp16(std::ldexp(1.0f, -24)) == 0x0001);
+	REQUIRE(__to_fp16(1e-9f) == 0);
+	REQUIRE(__to_fp16(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+	REQUIRE(__to_fp16(1.0f + 3 * std::ldexp(1.0f, -11)) == 0x3c02);
+
+	for (float x : { 0.5f, 3.25f, -1000.0f, 6.1035156e-05f, 5.9604645e-08f })
+		REQUIRE(__from_fp16(__to_fp16(x)) == x);
+
+	REQUIRE(mpiex::__to_bf16(1.0f) == 0x3f80);
+	REQUIRE(mpiex::__from_bf16(mpiex::__to_bf16(-3.5f)) == -3.5f);
+}
+
+TEST_CASE("compressed allreduce")
+{
+	using mpiex::compression;
+
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	// one hop of rounding per rank on the way, relative to the largest
+	for (auto c : { std::make_pair(compression::fp16, 1e-3),
+	    std::make_pair(compression::bf16, 8e-3),
+	    std::make_pair(compression::int8, 1e-2) })
+		for (size_t n : { 0, 3, 1000, 1001 })
+		{
+			std::vector<float> x(n), y(n), lo(n), hi(n);
+			for (size_t i = 0; i < n; ++i)
+				x[i] = float((rank + 1) * std::sin(i + 1.0));
+
+			allreduce_compressed(comm, x.data(), y.data(), n,
+			    std::plus<>(), c.first).get();
+
+			auto sum = p * (p + 1) / 2;
+			for (size_t i = 0; i < n; ++i)
+				REQUIRE(std::abs(y[i] - sum * std::sin(i + 1.0)) <=
+				    c.second * p * sum);
+
+			// the same result everywhere
+			MPI_Allreduce(y.data(), lo.data(), int(n), MPI_FLOAT,
+			    MPI_MIN, comm.get());
+			MPI_Allreduce(y.data(), hi.data(), int(n), MPI_FLOAT,
+			    MPI_MAX, comm.get());
+			REQUIRE(lo == hi);
+		}
+}
+
+TEST_CASE("error feedback")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+
+	std::vector<double> x(600, 0.1), e(600), y(600);
+	x[0] = 100;
+
+	for (int k = 0; k < 3; ++k)
+	{
+		allreduce_compressed(comm, x.data(), y.data(), x.size(),
+		    std::plus<>(), mpiex::compression::int8, e.data()).get();
+
+		for (size_t i = 0; i < x.size(); ++i)
+		{
+			REQUIRE(std::abs(e[i]) <= 100.0 / 127);
+			REQUIRE(std::abs(y[i] - p * x[i]) <= p * 100.0 / 127);
+		}
+	}
+
+	// with one contributor, the partial results encode exactly, and the
+	// sum of the results stays within one step of the exact sum only if
+	// the residual is carried over; 0.1 alone encodes to 0
+	auto rank = comm.rank();
+	std::vector<double> z(600, rank == 0 ? 0.1 : 0), r(600), s(600);
+	if (rank == 0)
+		z[0] = 100;
+
+	int const k = 20;
+	for (int j = 0; j < k; ++j)
+	{
+		allreduce_compressed(comm, z.data(), y.data(), z.size(),
+		    std::plus<>(), mpiex::compression::int8, r.data()).get();
+
+		for (size_t i = 0; i < z.size(); ++i)
+			s[i] += y[i];
+	}
+
+	for (size_t i = 1; i < z.size(); ++i)
+		REQUIRE(std::abs(s[i] - k * 0.1) <= 100.0 / 127);
+}
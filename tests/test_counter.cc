@@ -0,0 +1,61 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+TEST_CASE("global counter")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+
+	mpiex::global_counter c(comm, 100, p - 1);
+
+	std::vector<mpiex::future<long>> fs;
+	for (int i = 0; i < 10; ++i)
+		fs.push_back(c.fetch_add(2));
+
+	long last = -1;
+	for (auto& f : fs)
+	{
+		auto v = f.get();
+		REQUIRE(v >= 100);
+		REQUIRE(v % 2 == 0);
+		REQUIRE(v != last);
+		last = v;
+	}
+	barrier(comm).get();
+
+	REQUIRE(c.load().get() == 100 + 20 * p);
+	barrier(comm).get();
+}
+
+TEST_CASE("self-scheduling loop")
+{
+	using mpiex::loop_schedule;
+
+	auto comm = mpiex::communicator();
+
+	// a chunk of 0 counts as 1
+	for (auto s : { loop_schedule::fixed, loop_schedule::guided,
+	    loop_schedule::adaptive })
+		for (long chunk : { 3L, 0L })
+			for (long n : { 0L, 1L, 1000L })
+			{
+				auto sz = static_cast<size_t>(n);
+				std::vector<int> hits(sz), all(sz);
+				auto done = mpiex::dynamic_for(comm, n,
+				    [&](long first, long last)
+				    {
+					REQUIRE(first < last);
+					for (auto i = first; i < last; ++i)
+						++hits[size_t(i)];
+				    }, s, chunk);
+
+				REQUIRE(allreduce(comm, done, std::plus<>())
+				    .get() == n);
+				allreduce(comm, hits.data(), all.data(),
+				    hits.size(), std::plus<>()).get();
+				REQUIRE(all == std::vector<int>(sz, 1));
+			}
+}
@@ -0,0 +1,54 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+TEST_CASE("distributed hash map")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	mpiex::dist_unordered_map<long, double> m(comm);
+
+	// the keys 0 to 99 from everyone, of which half are duplicates
+	std::vector<std::pair<long, double>> items;
+	for (long k = 0; k < 100; ++k)
+		if (k % 2 == 0 || k % p == rank)
+			items.emplace_back(k, k + 0.5);
+
+	auto fresh = m.insert(items).get();
+	REQUIRE(fresh.size() == items.size());
+
+	long mine = 0;
+	for (auto b : fresh)
+		mine += b;
+	REQUIRE(allreduce(comm, mine, std::plus<>()).get() == 100);
+
+	for (auto& kv : m.local())
+		REQUIRE(m.owner(kv.first) == rank);
+	REQUIRE(allreduce(comm, long(m.local().size()), std::plus<>())
+	    .get() == 100);
+
+	std::vector<long> keys = { 150, long(rank), 99, -1, 0 };
+	auto found = m.find(keys).get();
+	REQUIRE(found.size() == keys.size());
+	REQUIRE_FALSE(found[0].first);
+	REQUIRE(found[1].first);
+	REQUIRE(found[1].second == rank + 0.5);
+	REQUIRE(found[2].second == 99.5);
+	REQUIRE_FALSE(found[3].first);
+	REQUIRE(found[4].second == 0.5);
+
+	// an empty batch still takes part
+	REQUIRE(m.find({}).get().empty());
+	REQUIRE(m.insert({ { 0L, -1.0 } }).get() ==
+	    std::vector<bool>{ false });
+
+	// a batch sees the ones made before it, whichever is waited on first
+	auto ins = m.insert({ { 1000L + rank, 1.0 } });
+	auto fnd = m.find({ 1000L + (rank + 1) % p });
+	REQUIRE(fnd.get()[0].first);
+	REQUIRE(ins.get() == std::vector<bool>{ true });
+}
@@ -0,0 +1,65 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+TEST_CASE("distributed vector")
+{
+	using mpiex::distribution;
+
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	for (auto d : { distribution::block, distribution::cyclic })
+		for (size_t n : { 0, 3, 100, 101 })
+		{
+			mpiex::dist_vector<long> v(comm, n, d);
+			REQUIRE(v.size() == n);
+
+			// the owners partition the indices
+			REQUIRE(allreduce(comm, long(v.local_size()),
+			    std::plus<>()).get() == long(n));
+			for (size_t k = 0; k < v.local_size(); ++k)
+			{
+				auto i = v.global_index(rank, k);
+				REQUIRE(v.owner(i) == rank);
+				REQUIRE(v.local_index(i) == k);
+				v.local_data()[k] = long(i);
+			}
+			v.sync();
+			barrier(comm).get();
+
+			// a range from everyone, with a hole at both ends
+			if (n > 2)
+			{
+				auto sz = n - 2;
+				std::vector<long> got(sz);
+				v.get(1, sz, got.data()).get();
+				for (size_t i = 0; i < sz; ++i)
+					REQUIRE(got[i] == long(i + 1));
+			}
+			barrier(comm).get();
+
+			// the last process negates all but the first element
+			if (rank == p - 1 && n > 1)
+			{
+				std::vector<long> neg(n - 1);
+				for (size_t i = 1; i < n; ++i)
+					neg[i - 1] = -long(i);
+				v.put(1, n - 1, neg.data()).get();
+			}
+			v.flush().get();
+			barrier(comm).get();
+			v.sync();
+
+			for (size_t k = 0; k < v.local_size(); ++k)
+			{
+				auto i = v.global_index(rank, k);
+				REQUIRE(v.local_data()[k] == (i == 0 ? 0 :
+				    -long(i)));
+			}
+			barrier(comm).get();
+		}
+}
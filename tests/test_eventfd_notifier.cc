@@ -0,0 +1,50 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <poll.h>
+
+#include <algorithm>
+
+TEST_CASE("eventfd notifier")
+{
+	// the notifier thread makes MPI calls
+	if (mpi_thread_provided() != MPI_THREAD_MULTIPLE)
+	{
+		WARN("skipped: MPI_THREAD_MULTIPLE is not provided");
+		return;
+	}
+
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	mpiex::eventfd_notifier n;
+
+	auto f1 = mpiex::async([]
+	    {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		return 1;
+	    }).share();
+	auto f2 = mpiex::receive<int>(comm, (rank + p - 1) % p).share();
+
+	n.watch(f1, 1);
+	n.watch(f2, 2);
+
+	auto fs = send(comm, (rank + 1) % p, rank);
+
+	std::vector<std::uint64_t> tags;
+	while (tags.size() < 2)
+	{
+		pollfd pfd = { n.fd(), POLLIN, 0 };
+		REQUIRE(::poll(&pfd, 1, -1) == 1);
+		for (auto t : n.poll())
+			tags.push_back(t);
+	}
+
+	std::sort(tags.begin(), tags.end());
+	REQUIRE(tags == (std::vector<std::uint64_t>{ 1, 2 }));
+	REQUIRE(f1.is_ready());
+	REQUIRE(f1.get() == 1);
+	REQUIRE(f2.get() == (rank + p - 1) % p);
+}
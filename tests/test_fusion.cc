@@ -0,0 +1,66 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+TEST_CASE("fused allreduce")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+	auto sum = p * (p + 1) / 2;
+
+	mpiex::fusion_buffer fb(comm, 1 << 20);
+
+	std::vector<int> x(100), y(100);
+	std::vector<double> u(10, 2.0), v(10);
+	std::vector<mpiex::future<void>> fs;
+
+	for (int i = 0; i < 100; ++i)
+	{
+		x[i] = (rank + 1) * i;
+		fs.push_back(fb.allreduce(&x[i], &y[i], 1, std::plus<>()));
+	}
+	fs.push_back(fb.allreduce(u.data(), v.data(), 10,
+	    std::multiplies<>()));
+
+	REQUIRE(fb.size() == 100 * sizeof(int) + 10 * sizeof(double));
+	REQUIRE_FALSE(fs[0].is_ready());
+
+	// waiting on one of them flushes all
+	fs.back().get();
+	REQUIRE(fb.size() == 0);
+	REQUIRE(v == std::vector<double>(10, double(1 << p)));
+
+	for (int i = 0; i < 100; ++i)
+	{
+		fs[i].get();
+		REQUIRE(y[i] == sum * i);
+	}
+}
+
+TEST_CASE("fusion byte budget")
+{
+	auto comm = mpiex::communicator();
+	auto rank = comm.rank();
+
+	mpiex::fusion_buffer fb(comm, 4 * sizeof(long));
+
+	std::vector<long> x(10, rank), y(10);
+	std::vector<mpiex::future<void>> fs;
+
+	for (int i = 0; i < 10; ++i)
+	{
+		fs.push_back(fb.allreduce(&x[i], &y[i], 1, std::plus<>()));
+		REQUIRE(fb.size() == (i + 1) % 4 * sizeof(long));
+	}
+
+	fb.flush();
+	while (!std::all_of(fs.begin(), fs.end(),
+	    [](auto& f) { return f.is_ready(); }))
+		;
+
+	auto p = long(comm.size());
+	REQUIRE(y == std::vector<long>(10, p * (p - 1) / 2));
+}
@@ -0,0 +1,92 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+// a value for each cell of the global grid
+static int
+cell(std::vector<int> const& g)
+{
+	int v = 0;
+	for (auto x : g)
+		v = v * 1000 + x;
+	return v;
+}
+
+static void
+check(mpiex::topo_communicator const& comm, std::vector<int> const& ext,
+    int ghost, bool corners)
+{
+	auto nd = ext.size();
+	std::vector<int> full(nd);
+	size_t n = 1;
+	for (size_t i = 0; i < nd; ++i)
+	{
+		full[i] = ext[i] + 2 * ghost;
+		n *= size_t(full[i]);
+	}
+
+	std::vector<int> a(n, -1);
+	mpiex::halo_exchange h(comm, a.data(), ext, ghost, corners);
+
+	// each cell by its local index, fill or check it by its global one
+	auto each = [&](bool fill)
+	{
+		std::vector<int> l(nd), g(nd);
+		for (size_t k = 0; k < n; ++k)
+		{
+			int outside = 0;
+			bool off = false;
+			for (size_t i = nd, v = k; i-- > 0; v /= size_t(full[i]))
+			{
+				l[i] = int(v % size_t(full[i])) - ghost;
+				outside += l[i] < 0 || l[i] >= ext[i];
+				g[i] = comm.coords()[i] * ext[i] + l[i];
+				auto span = comm.dims()[i] * ext[i];
+				if (comm.periods()[i])
+					g[i] = (g[i] + span) % span;
+				else if (g[i] < 0 || g[i] >= span)
+					off = true;
+			}
+
+			if (fill && outside == 0)
+				a[k] = cell(g);
+			else if (!fill && outside != 0)
+			{
+				auto want = off || (!corners && outside > 1) ?
+				    -1 : cell(g);
+				REQUIRE(a[k] == want);
+			}
+		}
+	};
+
+	each(true);
+	for (int i = 0; i < 2; ++i)
+	{
+		h.start();
+		h.finish().get();
+		each(false);
+	}
+}
+
+TEST_CASE("halo exchange in 2D")
+{
+	auto comm = mpiex::cart_create(mpiex::communicator(), { 0, 0 },
+	    { true, true });
+
+	check(comm, { 4, 3 }, 1, true);
+	check(comm, { 5, 6 }, 2, false);
+}
+
+TEST_CASE("halo exchange in 3D")
+{
+	auto comm = mpiex::cart_create(mpiex::communicator(), { 0, 0, 0 },
+	    { false, true, false });
+
+	mpiex::halo_exchange h(comm, static_cast<double*>(nullptr), { 1, 1, 1 },
+	    1, false);
+	REQUIRE(h.size() <= 6);
+
+	check(comm, { 3, 2, 4 }, 1, true);
+}
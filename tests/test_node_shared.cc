@@ -0,0 +1,42 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <numeric>
+
+TEST_CASE("node-shared array")
+{
+	auto comm = mpiex::communicator();
+
+	// a segment of its own for each process
+	mpiex::node_shared_array<long> table(comm, 1000);
+	auto& node = table.node();
+	REQUIRE(table.size() == 1000);
+
+	std::iota(table.data(), table.data() + table.size(),
+	    long(node.rank()) * 1000);
+	table.fence().get();
+
+	for (int i = 0; i < node.size(); ++i)
+	{
+		REQUIRE(table.segment_size(i) == 1000);
+		REQUIRE(table.segment(i)[0] == i * 1000);
+		REQUIRE(table.segment(i)[999] == i * 1000 + 999);
+	}
+	table.fence().get();
+
+	// everyone adds to the segment of the next process on the node
+	auto next = (node.rank() + 1) % node.size();
+	table.segment(next)[0] += 1;
+	table.fence().get();
+	REQUIRE(table.data()[0] == node.rank() * 1000 + 1);
+
+	// a table stored once per node, by its first process
+	mpiex::node_shared_array<double> once(comm,
+	    node.rank() == 0 ? 10 : 0);
+	if (node.rank() == 0)
+		once.data()[9] = 2.5;
+	once.fence().get();
+	REQUIRE(once.segment_size(0) == 10);
+	REQUIRE(once.segment(0)[9] == 2.5);
+}
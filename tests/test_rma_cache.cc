@@ -0,0 +1,63 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+TEST_CASE("RMA read cache")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	// 50 elements on each process, of the value rank * 1000 + i
+	mpiex::window<int> w(comm, 50);
+	for (int i = 0; i < 50; ++i)
+		w.data()[i] = rank * 1000 + i;
+	w.sync();
+	barrier(comm).get();
+
+	{
+		mpiex::rma_cache<int> c(comm, w, 8, 4);
+		auto next = (rank + 1) % p;
+
+		// the same block twice in flight, fetched once
+		int a, b;
+		auto fa = c.get(next, 1, &a, 1);
+		auto fb = c.get(next, 6, &b, 1);
+		fa.get();
+		fb.get();
+		REQUIRE(a == next * 1000 + 1);
+		REQUIRE(b == next * 1000 + 6);
+		REQUIRE(c.misses() == 1);
+		REQUIRE(c.hits() == 1);
+
+		// across four blocks, up to the short last one, evicting the
+		// least recently used, of a and b
+		std::vector<int> v(20);
+		c.get(next, 30, v.data(), v.size()).get();
+		for (int i = 0; i < 20; ++i)
+			REQUIRE(v[size_t(i)] == next * 1000 + 30 + i);
+		REQUIRE(c.misses() == 5);
+		REQUIRE(c.size() == 4);
+
+		c.get(next, 0, &a, 1).get();
+		REQUIRE(c.misses() == 6);
+		REQUIRE(c.size() == 4);
+		c.get(next, 49, &a, 1).get();
+		REQUIRE(c.misses() == 6);
+		REQUIRE(a == next * 1000 + 49);
+
+		c.invalidate();
+		REQUIRE(c.size() == 0);
+		c.get(next, 49, &a, 1).get();
+		REQUIRE(c.misses() == 7);
+
+		// a read completes even if its future is dropped
+		b = -1;
+		c.get(next, 17, &b, 1);
+		REQUIRE(b == next * 1000 + 17);
+		REQUIRE(c.misses() == 8);
+	}
+	barrier(comm).get();
+}
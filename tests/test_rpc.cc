@@ -0,0 +1,82 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+long bumps = 0;
+
+int
+add(int a, int b)
+{
+	return a + b;
+}
+
+void
+bump(long n)
+{
+	bumps += n;
+}
+
+double
+fail(double)
+{
+	throw std::runtime_error("no");
+}
+
+}
+
+TEST_CASE("remote call")
+{
+	auto world = mpiex::communicator();
+	auto p = world.size();
+	auto rank = world.rank();
+
+	// a tiny budget, so that some batches go out before the waits
+	mpiex::rpc_communicator comm(world, 64);
+	REQUIRE(comm.get() == world.get());
+
+	auto h_add = comm.add(&add);
+	auto h_bump = comm.add(&bump);
+	auto h_fail = comm.add(&fail);
+	auto h_mul = comm.add<long(long, short)>(
+	    [rank](long a, short b) { return a * b + rank; });
+
+	std::vector<mpiex::future<int>> sums;
+	for (int i = 0; i < 10; ++i)
+		for (int j = 0; j < p; ++j)
+			sums.push_back(mpiex::remote_call(comm, j, h_add, rank, i));
+	for (int i = 0; i < 10; ++i)
+		for (int j = 0; j < p; ++j)
+			REQUIRE(sums[size_t(i * p + j)].get() == rank + i);
+
+	// the result is computed by the callee
+	auto f = mpiex::remote_call(comm, (rank + 1) % p, h_mul, 3L, short(4));
+	while (!f.is_ready())
+		comm.poll();
+	REQUIRE(f.get() == 12 + (rank + 1) % p);
+
+	for (int j = 0; j < p; ++j)
+		mpiex::remote_call(comm, j, h_bump, long(rank)).get();
+	// serves the calls of the others until they are all done
+	mpiex::barrier(world).get();
+	auto all = long(p) * p * (p - 1) / 2;
+	REQUIRE(allreduce(world, bumps, std::plus<>()).get() == all);
+
+	// blocking on an unrelated future sends no batch
+	auto g = mpiex::remote_call(comm, (rank + 1) % p, h_bump, 1L);
+	mpiex::barrier(world).get();
+	REQUIRE(allreduce(world, bumps, std::plus<>()).get() == all);
+	g.get();
+	mpiex::barrier(world).get();
+	REQUIRE(allreduce(world, bumps, std::plus<>()).get() == all + p);
+
+	REQUIRE_THROWS(mpiex::remote_call(comm, 0, h_fail, 1.0).get());
+	REQUIRE(mpiex::remote_call(comm, 0, h_add, 1, 2).get() == 3);
+
+	mpiex::barrier(world).get();
+}
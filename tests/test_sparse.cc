@@ -0,0 +1,112 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+static std::vector<long>
+dense(mpiex::sparse_array<long> const& x)
+{
+	if (x.dense)
+		return x.value;
+
+	std::vector<long> v(x.size);
+	for (size_t k = 0; k < x.index.size(); ++k)
+		v[x.index[k]] = x.value[k];
+	return v;
+}
+
+TEST_CASE("sparse allreduce")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	// each rank owns a few positions of its own, and one shared by all
+	for (size_t n : { 0, 1, 64, 100000 })
+	{
+		mpiex::sparse_array<long> x;
+		x.size = n;
+		std::vector<long> want(n);
+
+		if (n != 0)
+		{
+			x.index.push_back(0);
+			x.value.push_back(rank + 1);
+			want[0] = p * (p + 1) / 2;
+		}
+		for (size_t i = 1; i < 4; ++i)
+			for (int r = 0; r < p; ++r)
+			{
+				auto at = size_t(r) * 7 + i;
+				if (at >= n)
+					continue;
+				if (r == rank)
+				{
+					x.index.push_back(at);
+					x.value.push_back(long(at));
+				}
+				want[at] += long(at);
+			}
+
+		auto y = sparse_allreduce(comm, x, std::plus<>()).get();
+
+		REQUIRE(y.size == n);
+		REQUIRE(dense(y) == want);
+		if (n == 100000)
+			REQUIRE_FALSE(y.dense);
+		if (n == 1)
+			REQUIRE(y.dense);
+	}
+}
+
+TEST_CASE("sparse allreduce going dense")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	// disjoint positions, dense from the start
+	mpiex::sparse_array<long> x;
+	x.size = size_t(p) * 10;
+	for (int i = 0; i < 10; ++i)
+	{
+		x.index.push_back(uint64_t(rank * 10 + i));
+		x.value.push_back(rank);
+	}
+
+	auto y = sparse_allreduce(comm, x, std::plus<>()).get();
+
+	REQUIRE(y.dense);
+	for (int i = 0; i < p * 10; ++i)
+		REQUIRE(dense(y)[size_t(i)] == i / 10);
+}
+
+TEST_CASE("sparse allreduce beyond the eager limit")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	// megabytes of pairs per rank, still sparse after the merges
+	mpiex::sparse_array<long> x;
+	x.size = 10000000;
+	auto nnz = 40000 + size_t(rank) * 1000;
+	for (size_t k = 0; k < nnz; ++k)
+	{
+		x.index.push_back(k * 97 + uint64_t(rank % 97));
+		x.value.push_back(long(k));
+	}
+
+	auto y = sparse_allreduce(comm, x, std::plus<>()).get();
+
+	REQUIRE_FALSE(y.dense);
+	size_t total = 0;
+	for (int r = 0; r < p; ++r)
+		total += 40000 + size_t(r) * 1000;
+	REQUIRE(y.index.size() == total);
+	size_t wrong = 0;
+	for (size_t k = 0; k < y.index.size(); ++k)
+		wrong += y.value[k] != long(y.index[k] / 97);
+	REQUIRE(wrong == 0);
+}
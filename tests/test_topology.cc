@@ -0,0 +1,57 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+TEST_CASE("Cartesian topology")
+{
+	auto world = mpiex::communicator();
+	auto p = world.size();
+
+	auto comm = mpiex::cart_create(world, { 0, 0 }, { true, false });
+	REQUIRE(comm.get() != MPI_COMM_NULL);
+	REQUIRE(comm.dims()[0] * comm.dims()[1] == p);
+
+	auto c = comm.coords();
+	REQUIRE(comm.rank_at(c) == comm.rank());
+	REQUIRE(comm.shift(0, 1).first == comm.rank_at({ c[0] - 1, c[1] }));
+	REQUIRE(comm.shift(1, 1).second == comm.rank_at({ c[0], c[1] + 1 }));
+	REQUIRE(comm.rank_at({ c[0], -1 }) == MPI_PROC_NULL);
+	REQUIRE(comm.sources().size() == 4);
+
+	// blocks from MPI_PROC_NULL are left untouched
+	int me = comm.rank();
+	std::vector<int> got(4, -1);
+	neighbor_allgather(comm, &me, got.data(), 1).get();
+
+	for (size_t i = 0; i < 4; ++i)
+		REQUIRE(got[i] == (comm.sources()[i] == MPI_PROC_NULL ? -1 :
+		    comm.sources()[i]));
+}
+
+TEST_CASE("distributed graph topology")
+{
+	auto world = mpiex::communicator();
+	auto p = world.size();
+	auto rank = world.rank();
+
+	// a ring, in which each rank sends rank + 1 elements to the next
+	auto comm = mpiex::dist_graph_create_adjacent(world,
+	    { (rank + p - 1) % p }, { (rank + 1) % p });
+	REQUIRE(comm.sources().size() == 1);
+	REQUIRE(comm.destinations().size() == 1);
+
+	auto me = comm.rank();
+	auto from = comm.sources()[0];
+	std::vector<int> v(size_t(me + 1), me), w(size_t(from + 1));
+	int sc = me + 1, rc = from + 1, zero = 0;
+
+	neighbor_alltoallv(comm, v.data(), &sc, &zero, w.data(), &rc, &zero)
+	    .get();
+	REQUIRE(w == std::vector<int>(size_t(from + 1), from));
+
+	// copies share the communicator
+	auto other = comm;
+	REQUIRE(other.get() == comm.get());
+}
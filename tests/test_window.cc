@@ -0,0 +1,73 @@
+#include "mpi_catch.h"
+
+#include <mpiex.h>
+
+#include <vector>
+
+TEST_CASE("RMA window")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	mpiex::window<int> w(comm, size_t(p) + 1);
+	REQUIRE(w.size() == size_t(p) + 1);
+	std::fill_n(w.data(), w.size(), 0);
+	barrier(comm).get();
+
+	// every rank writes its rank to its slot everywhere, and adds to the
+	// last slot of rank 0
+	std::vector<mpiex::future<void>> fs;
+	for (int i = 0; i < p; ++i)
+		fs.push_back(w.put(i, size_t(rank), rank * 10));
+	int one = 1;
+	fs.push_back(w.accumulate(0, size_t(p), &one, 1, std::plus<>()));
+	for (auto& f : fs)
+		f.get();
+	// polling alone never flushes
+	auto fl = w.flush_all();
+	REQUIRE_FALSE(fl.is_ready());
+	fl.get();
+	barrier(comm).get();
+	w.sync();
+
+	for (int i = 0; i < p; ++i)
+		REQUIRE(w.data()[i] == i * 10);
+	if (rank == 0)
+		REQUIRE(w.data()[p] == p);
+
+	auto next = (rank + 1) % p;
+	REQUIRE(w.get(next, size_t(next)).get() == next * 10);
+
+	std::vector<int> v(static_cast<size_t>(p));
+	w.get(next, 0, v.data(), v.size()).get();
+	for (int i = 0; i < p; ++i)
+		REQUIRE(v[i] == i * 10);
+	barrier(comm).get();
+}
+
+TEST_CASE("RMA window over user memory")
+{
+	auto comm = mpiex::communicator();
+	auto p = comm.size();
+	auto rank = comm.rank();
+
+	std::vector<double> mem(4, -1.0);
+	{
+		mpiex::window<double> w(comm, mem.data(), mem.size());
+		REQUIRE(w.data() == mem.data());
+
+		double x[2] = { rank + 0.5, rank + 0.25 };
+		auto prev = (rank + p - 1) % p;
+		w.put(prev, 1, x, 2).get();
+		// flushed by the destructor of the future
+		w.flush(prev);
+		barrier(comm).get();
+		w.sync();
+	}
+
+	auto next = (rank + 1) % p;
+	REQUIRE(mem[0] == -1.0);
+	REQUIRE(mem[1] == next + 0.5);
+	REQUIRE(mem[2] == next + 0.25);
+}